@@ -1,295 +1,2719 @@
 #ifndef __BINARY_H_
 #define __BINARY_H_
 
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
 #include <fstream>
+#include <limits>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <utility>
 #include <vector>
 #include <list>
 #include <map>
+#include <optional>
 #include <set>
 #include <tuple>
+#include <unordered_map>
 
+#include "codec.h"
+#include "compress.h"
 #include "helper.h"
+#include "stream.h"
 
-namespace detail {
+namespace binary {
+
+/**
+ * byte_order - the order of the bytes of numbers in the stream, native is the one of the host
+ * and the others are the same on any host
+ */
+enum class byte_order { native, little, big };
+
+/**
+ * options - the format of the binary stream, an object must be deserialized with the options
+ * it was serialized with
+ */
+struct options {
+    // sizes are written as LEB128 varints and integers wider than a byte as zigzag varints,
+    // containers of such integers are packed as stream VByte
+    bool compact = false;
+    // the byte order of the numbers and sizes which are not varints, in the other one than the
+    // host's they are byte swapped on the way in and out. The varints are always little-endian
+    byte_order order = byte_order::native;
+    // only read by deserialization: the destination containers are refilled in place, keeping
+    // their capacity, their nodes and the storage of their nested strings and containers
+    bool reuse = false;
+    // the stream is cut into blocks, which are compressed one by one by compress::block_sink
+    bool compress = false;
+    // the stream is cut into blocks, each followed by its CRC32C, which is verified when it is
+    // read, so a corrupt or truncated stream throws instead of being misread
+    bool checksum = false;
+    // the number of threads compressing or decompressing the blocks, with more than 1 they run
+    // beside the encoder or the decoder and one more thread writes or reads the file
+    unsigned threads = 1;
+    // a std::vector of a user type is written in columns, one per member of get_all_member, so a
+    // column of numbers is written as one block instead of interleaved with the other members
+    bool columnar = false;
+    // only read by deserialization: the bit i selects the member i of the columns to read, the
+    // others are skipped by their length and their members are left as they were with reuse
+    // and default otherwise. Columns holding shared pointers are always read
+    uint64_t column_mask = ~uint64_t(0);
+    // the floats and doubles of std::vectors and columns are written as the XOR of every number
+    // with the one before, without its leading and trailing zero bits, which shrinks slowly
+    // changing series. A std::array keeps its fixed size and is not compressed
+    bool xor_floats = false;
+    // a string met again is written as the id of its first occurrence in the stream, which
+    // shrinks repeated names and codes. Strings read into std::string_view from a buffer point
+    // to that first occurrence, so the repeated ones are not copied
+    bool string_dictionary = false;
+    // the raw numbers of std::vectors and spans start at a multiple of their alignment in the
+    // stream, so a stream in an aligned buffer can be deserialized into std::span views of them
+    bool aligned = false;
+};
 
+/**
+ * block_options_of - the block stage of the format opts, which is there when the stream is
+ * compressed or checksummed
+ */
+inline compress::block_options block_options_of(const options &opts) {
+    compress::block_options blocks;
+    blocks.compress = opts.compress;
+    blocks.checksum = opts.checksum;
+    blocks.threads = opts.threads;
+    return blocks;
+}
+
+/**
+ * type_id - an id of the type T which is cheap to hash and compare, unlike std::type_info whose
+ * hash is computed from its name
+ */
 template <typename T>
+struct type_id {
+    static constexpr char tag = 0;
+
+    static const void *get() {
+        return &tag;
+    }
+};
+
+// a slot of the table of the shared objects an encoder has written, empty while address is null
+struct shared_slot {
+    const void *address;
+    const void *type;
+    size_t id;
+};
+
+// the most strings a dictionary keeps, the ones met after it is full are written whole
+constexpr size_t max_dictionary = 1 << 16;
+
+struct string_hash {
+    using is_transparent = void;
+
+    size_t operator()(std::string_view s) const {
+        return std::hash<std::string_view>()(s);
+    }
+};
+
+/**
+ * spare_tables - the cleared string tables of the coders and columns which ended on this thread,
+ * the next ones take them over with their capacity, so a stream of messages deserialized one by
+ * one with options::reuse reads its dictionaries without allocating
+ */
+template <typename Table>
+std::vector<Table> &spare_tables() {
+    static thread_local std::vector<Table> tables;
+    return tables;
+}
+
+template <typename Table>
+Table take_spare_table() {
+    std::vector<Table> &spare = spare_tables<Table>();
+    if (spare.empty()) {
+        return Table();
+    }
+    Table table = std::move(spare.back());
+    spare.pop_back();
+    return table;
+}
+
+template <typename Table>
+void give_spare_table(Table &table) {
+    table.clear();
+    spare_tables<Table>().push_back(std::move(table));
+}
+
+/**
+ * encoder - the sink serialize_helper writes to, which forwards the bytes to sink and
+ * carries the options and the position of the stream
+ */
+template <typename Sink>
+class encoder {
+public:
+    encoder(Sink &sink, const options &opts) : sink_(sink), opts_(opts), pos_(0) {}
+
+    using string_table = std::unordered_map<std::string, size_t, string_hash, std::equal_to<>>;
+
+    /**
+     * encoder - an encoder into sink which goes on from the stream of other, at its position and
+     * with its shared objects, so a part of the stream can be measured before it is written. It
+     * starts a dictionary of strings of its own
+     */
+    template <typename Other>
+    encoder(Sink &sink, const encoder<Other> &other)
+        : sink_(sink), opts_(other.opts_), pos_(other.pos_), shared_ids_(other.shared_ids_),
+          shared_count_(other.shared_count_) {}
+
+    void write(const char *data, size_t n) {
+        sink_.write(data, n);
+        pos_ += n;
+    }
+
+    const options &format() const {
+        return opts_;
+    }
+
+    void set_aligned(bool aligned) {
+        opts_.aligned = aligned;
+    }
+
+    size_t position() const {
+        return pos_;
+    }
+
+    /**
+     * keep_shared - keep the shared objects written alive as long as the encoder, for an encoder
+     * which outlives the objects of one call. Otherwise the address of a destroyed object could be
+     * reused by another object of the same stream, which would be written as a reference
+     */
+    void keep_shared() {
+        keep_shared_ = true;
+    }
+
+    /**
+     * track_shared - the id of the shared object p of type type and whether it was written before,
+     * the ids count the shared objects in the order they are first written
+     */
+    template <typename T>
+    std::pair<size_t, bool> track_shared(const std::shared_ptr<T> &p, const void *type) {
+        // an open addressing table of the ids, kept at most half full
+        if (2 * (shared_count_ + 1) > shared_ids_.size()) {
+            rehash_shared(std::max<size_t>(64, 2 * shared_ids_.size()));
+        }
+        const void *address = p.get();
+        size_t mask = shared_ids_.size() - 1;
+        for (size_t i = hash_shared(address, type) & mask;; i = (i + 1) & mask) {
+            shared_slot &slot = shared_ids_[i];
+            if (slot.address == nullptr) {
+                slot = {address, type, shared_count_++};
+                if (keep_shared_) {
+                    shared_pins_.push_back(p);
+                }
+                return {slot.id, false};
+            }
+            if (slot.address == address && slot.type == type) {
+                return {slot.id, true};
+            }
+        }
+    }
+
+    /**
+     * track_string - the id of the string s and whether it was written before, the strings first
+     * met take the next ids until the dictionary is full and max_dictionary after that
+     */
+    std::pair<size_t, bool> track_string(std::string_view s) {
+        auto it = strings_.find(s);
+        if (it != strings_.end()) {
+            return {it->second, true};
+        }
+        if (strings_.size() == max_dictionary) {
+            return {max_dictionary, false};
+        }
+        size_t id = strings_.size();
+        strings_.emplace(s, id);
+        return {id, false};
+    }
+
+    void swap_strings(string_table &strings) {
+        strings_.swap(strings);
+    }
+
+private:
+    static size_t hash_shared(const void *address, const void *type) {
+        // objects allocated one after another land in nearby slots, the high bits spread large strides
+        uintptr_t key = reinterpret_cast<uintptr_t>(address) ^ reinterpret_cast<uintptr_t>(type);
+        return (key >> 4) ^ (key >> 20);
+    }
+
+    void rehash_shared(size_t capacity) {
+        std::vector<shared_slot> slots(capacity, shared_slot{nullptr, nullptr, 0});
+        for (const shared_slot &slot : shared_ids_) {
+            if (slot.address != nullptr) {
+                size_t i = hash_shared(slot.address, slot.type) & (capacity - 1);
+                while (slots[i].address != nullptr) {
+                    i = (i + 1) & (capacity - 1);
+                }
+                slots[i] = slot;
+            }
+        }
+        shared_ids_.swap(slots);
+    }
+
+    template <typename Other>
+    friend class encoder;
+
+    Sink &sink_;
+    options opts_;
+    size_t pos_;
+    std::vector<shared_slot> shared_ids_;
+    size_t shared_count_ = 0;
+    bool keep_shared_ = false;
+    std::vector<std::shared_ptr<const void>> shared_pins_;
+    string_table strings_;
+};
+
+// the sources whose borrowed bytes stay valid as long as their buffer, unlike the decompressed
+// blocks of a compress::block_source
+template <typename Source>
+struct keeps_buffer : detail::has_borrow<Source> {};
+
+template <typename Source>
+struct keeps_buffer<compress::block_source<Source>> : std::false_type {};
+
+/**
+ * decoder - the source deserialize_helper reads from, which takes the bytes from source and
+ * carries the options and the position of the stream
+ */
+template <typename Source>
+class decoder {
+public:
+    decoder(Source &source, const options &opts) : source_(source), opts_(opts), pos_(0) {
+        if (opts_.string_dictionary) {
+            strings_ = take_spare_table<string_table>();
+        }
+    }
+
+    decoder(const decoder &) = delete;
+    decoder &operator=(const decoder &) = delete;
+
+    ~decoder() {
+        if (opts_.string_dictionary) {
+            give_spare_table(strings_);
+        }
+    }
+
+    void read(char *data, size_t n) {
+        source_.read(data, n);
+        pos_ += n;
+    }
+
+    // only there when source is a buffer which can be borrowed from
+    template <typename S = Source>
+    auto borrow(size_t n) -> decltype(std::declval<S &>().borrow(n)) {
+        pos_ += n;
+        return source_.borrow(n);
+    }
+
+    template <typename S = Source>
+    auto skip(size_t n) -> decltype(std::declval<S &>().skip(n)) {
+        pos_ += n;
+        return source_.skip(n);
+    }
+
+    // only there when source knows how many bytes it has left
+    template <typename S = Source>
+    auto remaining() const -> decltype(std::declval<const S &>().remaining()) {
+        return source_.remaining();
+    }
+
+    const options &format() const {
+        return opts_;
+    }
+
+    void set_aligned(bool aligned) {
+        opts_.aligned = aligned;
+    }
+
+    size_t position() const {
+        return pos_;
+    }
+
+    /**
+     * add_shared - give the next id to the shared object p of type type, before its contents are
+     * read so that the objects it points to can point back to it
+     */
+    void add_shared(std::shared_ptr<void> p, const void *type) {
+        shared_.emplace_back(std::move(p), type);
+    }
+
+    /**
+     * find_shared - the shared object read before with the id, which must be of type type
+     */
+    const std::shared_ptr<void> &find_shared(size_t id, const void *type) const {
+        if (id >= shared_.size() || shared_[id].second != type) {
+            throw std::invalid_argument("binary: corrupt reference to a shared object");
+        }
+        return shared_[id].first;
+    }
+
+    /*
+     * the strings of the dictionary are views into the buffer of the source when it keeps its
+     * buffer, and into copies in store otherwise, which a std::list never moves
+     */
+    struct string_table {
+        std::vector<std::string_view> views;
+        std::list<std::string> store;
+        // the strings of the store before it was cleared, which keep their capacity
+        std::list<std::string> spare;
+
+        void clear() {
+            views.clear();
+            spare.splice(spare.end(), store);
+        }
+    };
+
+    /**
+     * add_string - give the next id to the string s, which is copied unless it is in the buffer
+     * of the source
+     */
+    void add_string(std::string_view s, bool in_buffer) {
+        if (strings_.views.size() == max_dictionary) {
+            throw std::invalid_argument("binary: corrupt dictionary of strings");
+        }
+        if (!in_buffer && strings_.spare.empty()) {
+            s = strings_.store.emplace_back(s);
+        } else if (!in_buffer) {
+            strings_.store.splice(strings_.store.end(), strings_.spare, strings_.spare.begin());
+            s = strings_.store.back().assign(s);
+        }
+        strings_.views.push_back(s);
+    }
+
+    std::string_view find_string(size_t id) const {
+        if (id >= strings_.views.size()) {
+            throw std::invalid_argument("binary: corrupt reference to a string");
+        }
+        return strings_.views[id];
+    }
+
+    void swap_strings(string_table &strings) {
+        std::swap(strings_, strings);
+    }
+
+private:
+    Source &source_;
+    options opts_;
+    size_t pos_;
+    std::vector<std::pair<std::shared_ptr<void>, const void *>> shared_;
+    string_table strings_;
+};
+
+template <typename Source>
+struct keeps_buffer<decoder<Source>> : keeps_buffer<Source> {};
+
+} // namespace binary
+
+namespace detail {
+
+template <typename T, typename Sink>
 typename std::enable_if<!is_pair<std::remove_reference_t<T>>::value &&
                         !is_tuple<std::remove_reference_t<T>>::value &&
-                        !is_smart_ptr<std::remove_reference_t<T>>::value>::type
-serialize_stl(T &&val, std::fstream &fs);
+                        !is_smart_ptr<std::remove_reference_t<T>>::value &&
+                        !is_std_array<std::remove_reference_t<T>>::value &&
+                        !is_bulk_container<std::remove_reference_t<T>>::value>::type
+serialize_stl(T &&val, Sink &sink);
 
-template <typename T>
+template <typename T, typename Sink>
+typename std::enable_if<is_bulk_container<std::remove_reference_t<T>>::value>::type
+serialize_stl(T &&val, Sink &sink);
+
+template <typename T, typename Sink>
 typename std::enable_if<is_pair<std::remove_reference_t<T>>::value>::type
-serialize_stl(T &&val, std::fstream &fs);
+serialize_stl(T &&val, Sink &sink);
 
-template <typename T>
+template <typename T, typename Sink>
 typename std::enable_if<is_tuple<std::remove_reference_t<T>>::value>::type
-serialize_stl(T &&val, std::fstream &fs);
+serialize_stl(T &&val, Sink &sink);
 
-template <typename T>
+template <typename T, typename Sink>
 typename std::enable_if<is_smart_ptr<std::remove_reference_t<T>>::value>::type
-serialize_stl(T &&val, std::fstream &fs);
+serialize_stl(T &&val, Sink &sink);
 
-template <typename T1, typename T2>
-void deserialize_stl(std::pair<T1, T2> &val, std::fstream &fs);
+template <typename T, typename Sink>
+typename std::enable_if<is_std_array<std::remove_reference_t<T>>::value>::type
+serialize_stl(T &&val, Sink &sink);
 
-template <typename T1, typename T2>
-void deserialize_stl(std::map<T1, T2> &val, std::fstream &fs);
+template <typename T1, typename T2, typename Source>
+void deserialize_stl(std::pair<T1, T2> &val, Source &source);
+
+template <typename T1, typename T2, typename Source>
+void deserialize_stl(std::map<T1, T2> &val, Source &source);
+
+template <typename T, typename Source>
+typename std::enable_if<!is_bulk_container<std::vector<T>>::value>::type
+deserialize_stl(std::vector<T> &val, Source &source);
+
+template <typename T, typename Source>
+typename std::enable_if<is_bulk_container<std::vector<T>>::value>::type
+deserialize_stl(std::vector<T> &val, Source &source);
+
+template <typename T, typename Source>
+void deserialize_stl(std::set<T> &val, Source &source);
+
+template <typename T, typename Source>
+void deserialize_stl(std::list<T> &val, Source &source);
+
+template <typename T, size_t N, typename Source>
+void deserialize_stl(std::array<T, N> &val, Source &source);
+
+template <typename... Args, typename Source>
+void deserialize_stl(std::tuple<Args...> &val, Source &source);
+
+template <typename... Args, typename Source>
+void deserialize_tuple(std::tuple<Args...> &tuple, Source &source);
+
+template <typename T, typename Source>
+void deserialize_stl(std::unique_ptr<T> &val, Source &source);
+
+template <typename T, typename Source>
+void deserialize_stl(std::shared_ptr<T> &val, Source &source);
+
+template <typename T, typename Source>
+void deserialize_stl(std::weak_ptr<T> &val, Source &source);
+
+template <typename Stream>
+typename std::enable_if<has_format<Stream>::value, const binary::options &>::type
+format_of(Stream &stream) {
+    return stream.format();
+}
+
+template <typename Stream>
+typename std::enable_if<!has_format<Stream>::value, binary::options>::type
+format_of(Stream &) {
+    return binary::options();
+}
+
+/**
+ * swaps_bytes - whether the numbers of the stream are in the other byte order than the host's
+ */
+template <typename Stream>
+bool swaps_bytes(Stream &stream) {
+    switch (format_of(stream).order) {
+    case binary::byte_order::little:
+        return std::endian::native != std::endian::little;
+    case binary::byte_order::big:
+        return std::endian::native != std::endian::big;
+    default:
+        return false;
+    }
+}
+
+/**
+ * write_value - write the bytes of the number val in the byte order of the stream
+ */
+template <typename T, typename Sink>
+void write_value(T val, Sink &sink) {
+    if (sizeof(T) > 1 && swaps_bytes(sink)) {
+        val = codec::byte_swapped(val);
+    }
+    sink.write(reinterpret_cast<const char *>(&val), sizeof(T));
+}
+
+template <typename T, typename Source>
+void read_value(T &val, Source &source) {
+    source.read(reinterpret_cast<char *>(&val), sizeof(T));
+    if (sizeof(T) > 1 && swaps_bytes(source)) {
+        val = codec::byte_swapped(val);
+    }
+}
+
+// the stack buffer numbers are byte swapped through on their way to the sink
+constexpr size_t swap_chunk = 4096;
+
+/**
+ * write_raw - write the n numbers in data back to back in the byte order of the stream, as one
+ * block when it is the host's
+ */
+template <typename T, typename Sink>
+void write_raw(const T *data, size_t n, Sink &sink) {
+    if constexpr (sizeof(T) > 1) {
+        if (swaps_bytes(sink)) {
+            char buf[swap_chunk];
+            for (size_t done = 0; done < n;) {
+                size_t m = std::min(n - done, swap_chunk / sizeof(T));
+                codec::byte_swap<sizeof(T)>(reinterpret_cast<const char *>(data + done), m, buf);
+                sink.write(buf, sizeof(T) * m);
+                done += m;
+            }
+            return;
+        }
+    }
+    sink.write(reinterpret_cast<const char *>(data), sizeof(T) * n);
+}
+
+template <typename T, typename Source>
+void read_raw(T *data, size_t n, Source &source) {
+    source.read(reinterpret_cast<char *>(data), sizeof(T) * n);
+    if constexpr (sizeof(T) > 1) {
+        if (swaps_bytes(source)) {
+            codec::byte_swap<sizeof(T)>(reinterpret_cast<const char *>(data), n, reinterpret_cast<char *>(data));
+        }
+    }
+}
+
+/**
+ * check_host_order - raw structs and views keep the bytes of the host, so their format must
+ * store numbers in the host's byte order
+ */
+template <typename Stream>
+void check_host_order(Stream &stream) {
+    if (swaps_bytes(stream)) {
+        throw std::invalid_argument("binary: raw structs and spans can only be stored in the byte order of the host");
+    }
+}
+
+template <typename Sink>
+void write_varint(uint64_t val, Sink &sink) {
+    char buf[codec::max_varint_size];
+    sink.write(buf, codec::encode_varint(val, buf));
+}
+
+/**
+ * read_varint - read a varint written by write_varint, throw std::out_of_range when it runs over
+ * 10 bytes or its last byte carries bits beyond the 64 of the value
+ */
+template <typename Source>
+uint64_t read_varint(Source &source) {
+    uint64_t val = 0;
+    for (int shift = 0;; shift += 7) {
+        unsigned char byte;
+        source.read(reinterpret_cast<char *>(&byte), 1);
+        if (shift == 63 && byte > 1) {
+            throw std::out_of_range("binary: the varint does not fit in 64 bits");
+        }
+        val |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return val;
+        }
+    }
+}
+
+template <typename T>
+uint64_t to_varint(T val) {
+    if (std::is_signed_v<T>) {
+        return codec::zigzag_encode(val);
+    }
+    return val;
+}
+
+template <typename T>
+T from_varint(uint64_t val) {
+    if (std::is_signed_v<T>) {
+        return static_cast<T>(codec::zigzag_decode(val));
+    }
+    return static_cast<T>(val);
+}
+
+// sizes are stored in 64 bits, which may not fit size_t of a 32-bit host
+inline size_t to_size(uint64_t size) {
+    if (size > std::numeric_limits<size_t>::max()) {
+        throw std::length_error("binary: the size does not fit in size_t");
+    }
+    return static_cast<size_t>(size);
+}
+
+// containers are allocated ahead of their bytes only up to this many bytes, larger ones grow as
+// the bytes are read, so a corrupt size runs into the end of the stream instead of allocating it
+constexpr size_t max_prealloc = 1 << 24;
+
+template <typename T>
+size_t prealloc_count(size_t size) {
+    return std::min(size, std::max<size_t>(max_prealloc / sizeof(T), 1));
+}
+
+/*
+ * a source which knows the bytes it has left bounds a corrupt size by them, so all size elements
+ * are allocated at once when those bytes can hold them at min_bits each
+ */
+template <typename T, typename Source>
+size_t prealloc_count(size_t size, Source &source, size_t min_bits) {
+    if constexpr (has_remaining<Source>::value) {
+        if (size <= source.remaining() * 8 / min_bits) {
+            return size;
+        }
+    }
+    return prealloc_count<T>(size);
+}
+
+/**
+ * read_growing - resize val to size elements, and call read(first, n) to read the n elements from
+ * first on. count of them, from prealloc_count, are allocated at once, and a larger val doubles
+ * as it is read
+ */
+template <typename Container, typename Read>
+void read_growing(Container &val, size_t size, size_t count, Read &&read) {
+    val.reserve(count);
+    val.resize(count);
+    size_t done = 0;
+    for (;;) {
+        read(done, val.size() - done);
+        done = val.size();
+        if (done == size) {
+            return;
+        }
+        val.resize(std::min(size, 2 * done));
+    }
+}
+
+/**
+ * write_size - sizes are written as 4 bytes, and the ones which do not fit are written as
+ * 0xffffffff followed by 8 bytes. The compact format writes them as varints
+ */
+template <typename Sink>
+void write_size(size_t size, Sink &sink) {
+    if (format_of(sink).compact) {
+        write_varint(size, sink);
+    } else if (size < 0xffffffffu) {
+        write_value(static_cast<uint32_t>(size), sink);
+    } else {
+        write_value(0xffffffffu, sink);
+        write_value(static_cast<uint64_t>(size), sink);
+    }
+}
+
+template <typename Source>
+size_t read_size(Source &source) {
+    if (format_of(source).compact) {
+        return to_size(read_varint(source));
+    }
+    uint32_t small;
+    read_value(small, source);
+    if (small != 0xffffffffu) {
+        return small;
+    }
+    uint64_t large;
+    read_value(large, source);
+    return to_size(large);
+}
+
+/**
+ * borrow - the pointer to the next n bytes of source, which views point into
+ */
+template <typename Source>
+const char *borrow(size_t n, Source &source) {
+    static_assert(has_borrow<Source>::value,
+                  "binary: views can only be deserialized from a buffer, like stream::memory_source or stream::mmap_source");
+    return source.borrow(n);
+}
+
+/*
+ * with options::string_dictionary a string is written behind a size tag: 0 for a string the full
+ * dictionary does not keep and 1 for one kept under the next id, both followed by the string,
+ * and 2 + id for the string with the id written before
+ */
+template <typename Sink>
+void write_string(std::string_view val, Sink &sink) {
+    if constexpr (has_format<Sink>::value) {
+        if (format_of(sink).string_dictionary) {
+            auto [id, written] = sink.track_string(val);
+            if (written) {
+                write_size(2 + id, sink);
+                return;
+            }
+            write_size(id < binary::max_dictionary ? 1 : 0, sink);
+        }
+    }
+    write_size(val.size(), sink);
+    sink.write(val.data(), val.size());
+}
+
+/**
+ * read_string - read a string written by write_string into val, a string kept in the dictionary
+ * is borrowed from the buffer of source when it keeps it
+ */
+template <typename Source>
+void read_string(std::string &val, Source &source) {
+    bool keep = false;
+    if constexpr (has_format<Source>::value) {
+        if (format_of(source).string_dictionary) {
+            size_t tag = read_size(source);
+            if (tag >= 2) {
+                val.assign(source.find_string(tag - 2));
+                return;
+            }
+            keep = tag == 1;
+        }
+    }
+    size_t size = read_size(source);
+    if constexpr (has_format<Source>::value && binary::keeps_buffer<Source>::value) {
+        if (keep) {
+            const char *data = source.borrow(size);
+            val.assign(data, size);
+            source.add_string(std::string_view(data, size), true);
+            return;
+        }
+    }
+    // read into the storage of val directly, which also keeps the embedded '\0'
+    read_growing(val, size, prealloc_count<char>(size, source, 8), [&val, &source](size_t first, size_t n) {
+        source.read(&val[first], n);
+    });
+    if constexpr (has_format<Source>::value) {
+        if (keep) {
+            source.add_string(val, false);
+        }
+    }
+}
+
+/*
+ * a std::string_view read from the dictionary points to the first occurrence of the string in
+ * the buffer, so equal strings share their bytes
+ */
+template <typename Source>
+void read_string(std::string_view &val, Source &source) {
+    bool keep = false;
+    if constexpr (has_format<Source>::value) {
+        if (format_of(source).string_dictionary) {
+            size_t tag = read_size(source);
+            if (tag >= 2) {
+                if constexpr (!binary::keeps_buffer<Source>::value) {
+                    // the copies of the dictionary do not outlive the decoder, so this throws
+                    // like the views of the strings written whole
+                    borrow(0, source);
+                }
+                val = source.find_string(tag - 2);
+                return;
+            }
+            keep = tag == 1;
+        }
+    }
+    size_t size = read_size(source);
+    val = std::string_view(borrow(size, source), size);
+    if constexpr (has_format<Source>::value) {
+        if (keep) {
+            source.add_string(val, true);
+        }
+    }
+}
 
 template <typename T>
-void deserialize_stl(std::vector<T> &val, std::fstream &fs);
+using packed_word = typename std::conditional<(sizeof(T) <= 4), uint32_t, uint64_t>::type;
+
+template <typename Word>
+struct packed_codec;
+
+template <>
+struct packed_codec<uint32_t> {
+    static size_t encode(const uint32_t *in, size_t n, uint8_t *control, uint8_t *data) {
+        return codec::svb_encode32(in, n, control, data);
+    }
+
+    static size_t data_size(const uint8_t *control, size_t n) {
+        return codec::svb_data_size32(control, n);
+    }
+
+    static void decode(const uint8_t *control, const uint8_t *data, size_t n, uint32_t *out) {
+        codec::svb_decode32(control, data, n, out);
+    }
+};
+
+template <>
+struct packed_codec<uint64_t> {
+    static size_t encode(const uint64_t *in, size_t n, uint8_t *control, uint8_t *data) {
+        return codec::svb_encode64(in, n, control, data);
+    }
+
+    static size_t data_size(const uint8_t *control, size_t n) {
+        return codec::svb_data_size64(control, n);
+    }
+
+    static void decode(const uint8_t *control, const uint8_t *data, size_t n, uint64_t *out) {
+        codec::svb_decode64(control, data, n, out);
+    }
+};
+
+// integer containers of the compact format are written as stream VByte in chunks of this many
+// integers, so the buffers of the codec fit on the stack
+constexpr size_t packed_chunk = 1024;
+
+/**
+ * write_packed - write the n integers from it as stream VByte, signed ones zigzag encoded
+ */
+template <typename T, typename Iterator, typename Sink>
+void write_packed(Iterator it, size_t n, Sink &sink) {
+    using word = packed_word<T>;
+    word values[packed_chunk];
+    uint8_t control[codec::svb_control_size(packed_chunk)];
+    uint8_t data[packed_chunk * sizeof(word)];
+    for (size_t done = 0; done < n; done += packed_chunk) {
+        size_t m = std::min(packed_chunk, n - done);
+        for (size_t i = 0; i < m; i++, ++it) {
+            values[i] = static_cast<word>(to_varint<T>(*it));
+        }
+        size_t len = packed_codec<word>::encode(values, m, control, data);
+        sink.write(reinterpret_cast<const char *>(control), codec::svb_control_size(m));
+        sink.write(reinterpret_cast<const char *>(data), len);
+    }
+}
+
+/**
+ * read_packed - read n integers written by write_packed, f is called with every decoded chunk
+ */
+template <typename T, typename Source, typename Func>
+void read_packed(size_t n, Source &source, Func &&f) {
+    using word = packed_word<T>;
+    word values[packed_chunk + codec::svb_padding];
+    uint8_t control[codec::svb_control_size(packed_chunk)];
+    uint8_t data[packed_chunk * sizeof(word) + codec::svb_padding];
+    for (size_t done = 0; done < n; done += packed_chunk) {
+        size_t m = std::min(packed_chunk, n - done);
+        source.read(reinterpret_cast<char *>(control), codec::svb_control_size(m));
+        size_t len = packed_codec<word>::data_size(control, m);
+        source.read(reinterpret_cast<char *>(data), len);
+        packed_codec<word>::decode(control, data, m, values);
+        f(values, m);
+    }
+}
+
+/*
+ * the keys of ordered containers of integers rise, so the compact format writes them as the
+ * first key followed by the gaps to the next ones less one. The gaps are bit-packed by
+ * codec::bp_pack in frames behind a byte of their width, a frame with a gap wider than 32 bits
+ * is written as varints behind wide_frame, and the gaps of the last partial frame as varints
+ */
+constexpr uint8_t wide_frame = 0xff;
+
+/**
+ * write_ascending - write the n rising keys key(*it) as gaps
+ */
+template <typename T, typename Iterator, typename Key, typename Sink>
+void write_ascending(Iterator it, size_t n, Key &&key, Sink &sink) {
+    using word = std::make_unsigned_t<T>;
+    if (n == 0) {
+        return;
+    }
+    write_varint(to_varint<T>(key(*it)), sink);
+    word prev = static_cast<word>(key(*it));
+    ++it;
+    uint64_t gaps[codec::bp_frame];
+    uint32_t narrow[codec::bp_frame];
+    uint8_t data[codec::bp_size(32)];
+    size_t done = 1;
+    for (; n - done >= codec::bp_frame; done += codec::bp_frame) {
+        uint64_t any = 0;
+        for (size_t i = 0; i < codec::bp_frame; i++, ++it) {
+            word cur = static_cast<word>(key(*it));
+            gaps[i] = static_cast<word>(cur - prev - 1);
+            any |= gaps[i];
+            prev = cur;
+        }
+        if (any > std::numeric_limits<uint32_t>::max()) {
+            sink.write(reinterpret_cast<const char *>(&wide_frame), 1);
+            for (uint64_t gap : gaps) {
+                write_varint(gap, sink);
+            }
+            continue;
+        }
+        for (size_t i = 0; i < codec::bp_frame; i++) {
+            narrow[i] = static_cast<uint32_t>(gaps[i]);
+        }
+        uint8_t bits = static_cast<uint8_t>(std::bit_width(any));
+        codec::bp_pack(narrow, bits, data);
+        sink.write(reinterpret_cast<const char *>(&bits), 1);
+        sink.write(reinterpret_cast<const char *>(data), codec::bp_size(bits));
+    }
+    for (; done < n; done++, ++it) {
+        word cur = static_cast<word>(key(*it));
+        write_varint(static_cast<word>(cur - prev - 1), sink);
+        prev = cur;
+    }
+}
+
+/**
+ * read_ascending - read n keys written by write_ascending, f is called with every decoded frame
+ */
+template <typename T, typename Source, typename Func>
+void read_ascending(size_t n, Source &source, Func &&f) {
+    using word = std::make_unsigned_t<T>;
+    if (n == 0) {
+        return;
+    }
+    T keys[codec::bp_frame];
+    keys[0] = from_varint<T>(read_varint(source));
+    word prev = static_cast<word>(keys[0]);
+    f(keys, 1);
+    uint32_t gaps[codec::bp_frame];
+    uint8_t data[codec::bp_size(32)];
+    size_t done = 1;
+    for (; n - done >= codec::bp_frame; done += codec::bp_frame) {
+        uint8_t bits;
+        source.read(reinterpret_cast<char *>(&bits), 1);
+        if (bits == wide_frame) {
+            for (size_t i = 0; i < codec::bp_frame; i++) {
+                prev = static_cast<word>(prev + read_varint(source) + 1);
+                keys[i] = static_cast<T>(prev);
+            }
+        } else {
+            if (bits > 32) {
+                throw std::invalid_argument("binary: corrupt bit-packed keys");
+            }
+            source.read(reinterpret_cast<char *>(data), codec::bp_size(bits));
+            codec::bp_unpack(data, bits, gaps);
+            for (size_t i = 0; i < codec::bp_frame; i++) {
+                prev = static_cast<word>(prev + gaps[i] + 1);
+                keys[i] = static_cast<T>(prev);
+            }
+        }
+        f(keys, codec::bp_frame);
+    }
+    size_t m = n - done;
+    for (size_t i = 0; i < m; i++) {
+        prev = static_cast<word>(prev + read_varint(source) + 1);
+        keys[i] = static_cast<T>(prev);
+    }
+    if (m > 0) {
+        f(keys, m);
+    }
+}
+
+/*
+ * the keys of ordered containers of strings are sorted, so neighbours share prefixes and the
+ * compact format front codes them: every key is written as the length of the prefix it shares
+ * with the key before and the rest of it. Every restart_interval-th key shares nothing, a
+ * restart point. The keys are written behind the byte length of their block and followed by
+ * the offsets of the restart points in the block, little-endian in restart_width bytes each, so
+ * binary::front_coded_keys finds a key by a binary search of the restart points
+ */
+constexpr size_t restart_interval = 16;
 
+constexpr size_t restart_width(uint64_t bytes) {
+    return bytes >> 32 ? 8 : 4;
+}
+
+inline size_t shared_prefix(std::string_view a, std::string_view b) {
+    size_t n = std::min(a.size(), b.size());
+    return std::mismatch(a.begin(), a.begin() + n, b.begin()).first - a.begin();
+}
+
+/*
+ * with options::xor_floats the numbers are written in frames of packed_chunk compressed by
+ * codec::xor_encode, each behind its length in bytes. A frame starts over from a whole number,
+ * so the steps of read_growing, which are multiples of packed_chunk, decode whole frames
+ */
+template <typename T, typename Sink>
+void write_xor(const T *data, size_t n, Sink &sink) {
+    uint8_t frame[codec::xor_bound<T>(packed_chunk)];
+    for (size_t done = 0; done < n; done += packed_chunk) {
+        size_t m = std::min(packed_chunk, n - done);
+        size_t len = codec::xor_encode(data + done, m, frame);
+        write_varint(len, sink);
+        sink.write(reinterpret_cast<const char *>(frame), len);
+    }
+}
+
+/**
+ * read_xor - read n numbers written by write_xor straight into data
+ */
+template <typename T, typename Source>
+void read_xor(T *data, size_t n, Source &source) {
+    uint8_t frame[codec::xor_bound<T>(packed_chunk) + codec::xor_padding];
+    for (size_t done = 0; done < n; done += packed_chunk) {
+        size_t m = std::min(packed_chunk, n - done);
+        uint64_t len = read_varint(source);
+        if (len > codec::xor_bound<T>(m)) {
+            throw std::invalid_argument("binary: corrupt XOR-compressed numbers");
+        }
+        source.read(reinterpret_cast<char *>(frame), len);
+        if (codec::xor_decode(frame, m, data + done) != len) {
+            throw std::invalid_argument("binary: corrupt XOR-compressed numbers");
+        }
+    }
+}
+
+/**
+ * is_packed - whether write_elements packs the numbers T with the format of sink, instead of
+ * writing sizeof(T) bytes for each
+ */
+template <typename T, typename Sink>
+bool is_packed(Sink &sink) {
+    return (is_compact_integer<T>::value && format_of(sink).compact) ||
+           (is_xor_float<T>::value && format_of(sink).xor_floats);
+}
+
+/**
+ * write_elements - write the n elements in data back to back, as one block unless the compact
+ * format or the XOR codec packs them
+ */
+template <typename T, typename Sink>
+typename std::enable_if<!is_compact_integer<T>::value && !is_xor_float<T>::value &&
+                        !is_trivially_serializable<T>::value>::type
+write_elements(const T *data, size_t n, Sink &sink) {
+    write_raw(data, n, sink);
+}
+
+/**
+ * layout_of - the size and the alignment of T, which are written ahead of its raw bytes so that
+ * a stream of a type with another layout is rejected instead of misread
+ */
 template <typename T>
-void deserialize_stl(std::set<T> &val, std::fstream &fs);
+constexpr uint32_t layout_of() {
+    static_assert(sizeof(T) < (1u << 24) && alignof(T) < (1u << 8), "binary: the type is too large to be written as raw bytes");
+    return static_cast<uint32_t>(sizeof(T)) << 8 | static_cast<uint32_t>(alignof(T));
+}
+
+// trivially serializable structs are written as raw bytes in any format
+template <typename T, typename Sink>
+typename std::enable_if<is_trivially_serializable<T>::value>::type
+write_elements(const T *data, size_t n, Sink &sink) {
+    check_trivially_serializable<T>();
+    check_host_order(sink);
+    uint32_t layout = layout_of<T>();
+    sink.write(reinterpret_cast<const char *>(&layout), sizeof(layout));
+    sink.write(reinterpret_cast<const char *>(data), sizeof(T) * n);
+}
+
+template <typename T, typename Sink>
+typename std::enable_if<is_compact_integer<T>::value>::type
+write_elements(const T *data, size_t n, Sink &sink) {
+    if (format_of(sink).compact) {
+        write_packed<T>(data, n, sink);
+    } else {
+        write_raw(data, n, sink);
+    }
+}
+
+template <typename T, typename Sink>
+typename std::enable_if<is_xor_float<T>::value>::type
+write_elements(const T *data, size_t n, Sink &sink) {
+    if (format_of(sink).xor_floats) {
+        write_xor(data, n, sink);
+    } else {
+        write_raw(data, n, sink);
+    }
+}
+
+/**
+ * pads_elements - whether the numbers T of a std::vector or a span are padded to their alignment,
+ * which options::aligned asks for when they are written raw
+ */
+template <typename T, typename Stream>
+bool pads_elements(Stream &stream) {
+    if constexpr (has_format<Stream>::value && is_bulk_element<T>::value && alignof(T) > 1) {
+        return format_of(stream).aligned && !is_packed<T>(stream);
+    } else {
+        return false;
+    }
+}
+
+/**
+ * write_padding - pad the stream with zeros up to a multiple of align, so the elements of a span
+ * start aligned when the stream is read from an aligned buffer
+ */
+template <typename Sink>
+void write_padding(size_t align, Sink &sink) {
+    static const char zeros[alignof(std::max_align_t)] = {};
+    sink.write(zeros, (align - sink.position() % align) % align);
+}
+
+template <typename Source>
+void read_padding(size_t align, Source &source) {
+    char zeros[alignof(std::max_align_t)];
+    source.read(zeros, (align - source.position() % align) % align);
+}
+
+template <typename T, typename Source>
+typename std::enable_if<!is_compact_integer<T>::value && !is_xor_float<T>::value &&
+                        !is_trivially_serializable<T>::value>::type
+read_elements(T *data, size_t n, Source &source) {
+    read_raw(data, n, source);
+}
+
+template <typename T, typename Source>
+void read_layout(Source &source) {
+    check_trivially_serializable<T>();
+    check_host_order(source);
+    uint32_t layout;
+    source.read(reinterpret_cast<char *>(&layout), sizeof(layout));
+    if (layout != layout_of<T>()) {
+        throw std::invalid_argument("binary: the size or alignment of the stored type does not match");
+    }
+}
+
+template <typename T, typename Source>
+typename std::enable_if<is_trivially_serializable<T>::value>::type
+read_elements(T *data, size_t n, Source &source) {
+    read_layout<T>(source);
+    source.read(reinterpret_cast<char *>(data), sizeof(T) * n);
+}
+
+template <typename T, typename Source>
+typename std::enable_if<is_compact_integer<T>::value>::type
+read_elements(T *data, size_t n, Source &source) {
+    if (!format_of(source).compact) {
+        read_raw(data, n, source);
+        return;
+    }
+    read_packed<T>(n, source, [&data](const packed_word<T> *values, size_t m) {
+        for (size_t i = 0; i < m; i++) {
+            data[i] = from_varint<T>(values[i]);
+        }
+        data += m;
+    });
+}
+
+template <typename T, typename Source>
+typename std::enable_if<is_xor_float<T>::value>::type
+read_elements(T *data, size_t n, Source &source) {
+    if (format_of(source).xor_floats) {
+        read_xor(data, n, source);
+    } else {
+        read_raw(data, n, source);
+    }
+}
+
+/**
+ * fixed_size - the serialized size of the types whose size does not depend on their value, which
+ * are arithmetic types, trivially serializable structs, and pairs, tuples, std::arrays and user
+ * types made of them. size is the size in the fixed format and bound the most the compact format
+ * takes
+ */
+template <typename T, typename = void>
+struct fixed_size {
+    static constexpr bool value = false;
+    static constexpr size_t size = 0;
+    static constexpr size_t bound = 0;
+};
 
 template <typename T>
-void deserialize_stl(std::list<T> &val, std::fstream &fs);
+struct fixed_size<T, typename std::enable_if<std::is_arithmetic_v<T>>::type> {
+    static constexpr bool value = true;
+    static constexpr size_t size = sizeof(T);
+    // a varint carries 7 bits per byte
+    static constexpr size_t bound = is_compact_integer<T>::value ? (8 * sizeof(T) + 6) / 7 : sizeof(T);
+};
 
 template <typename... Args>
-void deserialize_stl(std::tuple<Args...> &val, std::fstream &fs);
+struct fixed_size_sum {
+    static constexpr bool value = (fixed_size<Args>::value && ...);
+    static constexpr size_t size = (fixed_size<Args>::size + ... + 0);
+    static constexpr size_t bound = (fixed_size<Args>::bound + ... + 0);
+};
+
+template <typename T1, typename T2>
+struct fixed_size<std::pair<T1, T2>> : fixed_size_sum<T1, T2> {};
 
 template <typename... Args>
-void deserialize_tuple(std::tuple<Args...> &tuple, std::fstream &fs);
+struct fixed_size<std::tuple<Args...>> : fixed_size_sum<std::decay_t<Args>...> {};
+
+template <typename T, size_t N>
+struct fixed_size<std::array<T, N>> {
+    static constexpr bool value = fixed_size<T>::value;
+    static constexpr size_t size = N * fixed_size<T>::size;
+    // integers are packed as stream VByte by the compact format
+    static constexpr size_t bound = is_compact_integer<T>::value
+                                        ? codec::svb_control_size(N) + N * sizeof(packed_word<T>)
+                                        : N * fixed_size<T>::bound;
+};
+
+// the layout guard and the raw bytes
+template <typename T>
+struct fixed_size<T, typename std::enable_if<is_trivially_serializable<T>::value>::type> {
+    static constexpr bool value = true;
+    static constexpr size_t size = sizeof(uint32_t) + sizeof(T);
+    static constexpr size_t bound = size;
+};
 
 template <typename T>
-void deserialize_stl(std::unique_ptr<T> &val, std::fstream &fs);
+struct fixed_size<T, typename std::enable_if<!is_not_user_type<T>::value && has_get_all_member<T>::value &&
+                                             !is_trivially_serializable<T>::value>::type>
+        : fixed_size<std::decay_t<decltype(std::declval<T &>().get_all_member())>> {};
 
 template <typename T>
-void deserialize_stl(std::shared_ptr<T> &val, std::fstream &fs);
+size_t count_serialized(T &val, const binary::options &opts);
+
+}  // namespace detail
+
+namespace binary {
+
+template <typename T, typename Sink>
+typename std::enable_if<std::is_arithmetic_v<std::remove_reference_t<T>> &&
+                        !detail::is_compact_integer<std::remove_reference_t<T>>::value>::type
+serialize_helper(T &&val, Sink &sink) {
+    detail::write_value(val, sink);
+}
+
+template <typename T, typename Sink>
+typename std::enable_if<detail::is_compact_integer<std::remove_reference_t<T>>::value>::type
+serialize_helper(T &&val, Sink &sink) {
+    if (detail::format_of(sink).compact) {
+        detail::write_varint(detail::to_varint(val), sink);
+    } else {
+        detail::write_value(val, sink);
+    }
+}
+
+template <typename T, typename Sink>
+typename std::enable_if<detail::stl_container<std::remove_reference_t<T>>::value>::type
+serialize_helper(T &&val, Sink &sink) {
+    detail::serialize_stl(std::forward<T>(val), sink);
+}
+
+template <typename T, typename Sink>
+typename std::enable_if<std::is_same_v<std::remove_cv_t<std::remove_reference_t<T>>, std::string>>::type
+serialize_helper(T &&val, Sink &sink) {
+    detail::write_string(val, sink);
+}
+
+template <typename T, typename Sink>
+typename std::enable_if<std::is_same_v<std::remove_cv_t<std::remove_reference_t<T>>, std::string_view>>::type
+serialize_helper(T &&val, Sink &sink) {
+    detail::write_string(val, sink);
+}
+
+// a span is written like a std::vector of its elements, so either can be read back as the other
+template <typename T, typename Sink>
+typename std::enable_if<detail::is_span<std::remove_reference_t<T>>::value>::type
+serialize_helper(T &&val, Sink &sink) {
+    using element_type = std::remove_const_t<typename std::remove_reference_t<T>::element_type>;
+    detail::write_size(val.size(), sink);
+    if (detail::pads_elements<element_type>(sink)) {
+        detail::write_padding(alignof(element_type), sink);
+    }
+    detail::write_elements(val.data(), val.size(), sink);
+}
 
-}  // namespace detail
+template <typename T, typename Sink>
+typename std::enable_if<!detail::is_not_user_type<std::remove_reference_t<T>>::value &&
+                        detail::has_get_all_member<std::remove_reference_t<T>>::value &&
+                        !detail::is_trivially_serializable<std::remove_reference_t<T>>::value>::type
+serialize_helper(T &val, Sink &sink) {
+    serialize_helper(val.get_all_member(), sink);
+}
 
-namespace binary {
-    
-template <typename T>
-typename std::enable_if<std::is_arithmetic_v<std::remove_reference_t<T>>>::type
-serialize_helper(T &&val, std::fstream &fs) {
-    fs.write(reinterpret_cast<const char *>(&val), sizeof(T));
+template <typename T, typename Sink>
+typename std::enable_if<detail::is_trivially_serializable<std::remove_reference_t<T>>::value>::type
+serialize_helper(T &&val, Sink &sink) {
+    detail::write_elements(&val, 1, sink);
 }
 
-template <typename T>
-typename std::enable_if<detail::stl_container<std::remove_reference_t<T>>::value>::type
-serialize_helper(T &&val, std::fstream &fs) {
-    detail::serialize_stl(std::forward<T>(val), fs);
+/**
+ * serialize_to - serialize val into sink with the format opts, sink is any type with a member
+ * write(const char *, size_t), like the sinks in stream.h or std::fstream
+ */
+template <typename T, typename Sink>
+typename std::enable_if<detail::is_not_user_type<std::remove_reference_t<T>>::value ||
+                        detail::has_get_all_member<std::remove_reference_t<T>>::value ||
+                        detail::is_trivially_serializable<std::remove_reference_t<T>>::value>::type
+serialize_to(T &&val, Sink &sink, const options &opts = options()) {
+    if (opts.compress || opts.checksum) {
+        compress::block_sink<Sink> blocks(sink, block_options_of(opts));
+        encoder<compress::block_sink<Sink>> enc(blocks, opts);
+        serialize_helper(val, enc);
+        blocks.finish();
+        return;
+    }
+    encoder<Sink> enc(sink, opts);
+    serialize_helper(val, enc);
 }
 
+/**
+ * serialized_size - the number of bytes serialize_to writes for val with the format opts. It is a
+ * constant expression for fixed-shape types in the fixed format, and one counting pass without a
+ * copy of the bytes otherwise, so a buffer or a file can be sized before serialization
+ */
 template <typename T>
-typename std::enable_if<std::is_same_v<std::remove_reference_t<T>, std::string>>::type
-serialize_helper(T &&val, std::fstream &fs) {
-    int len = val.length();
-    fs.write(reinterpret_cast<const char *>(&len), sizeof(int));
-    fs.write(val.c_str(), val.length());
+constexpr size_t serialized_size(T &&val, const options &opts = options()) {
+    using type = std::remove_cv_t<std::remove_reference_t<T>>;
+    if constexpr (detail::fixed_size<type>::value) {
+        if (!opts.compact && !opts.compress && !opts.checksum) {
+            return detail::fixed_size<type>::size;
+        }
+    }
+    return detail::count_serialized(val, opts);
 }
 
+/**
+ * max_serialized_size - the most bytes a value of the fixed-shape type T takes with the format opts
+ */
 template <typename T>
-typename std::enable_if<!detail::is_not_user_type<std::remove_reference_t<T>>::value &&
-                        detail::has_get_all_member<std::remove_reference_t<T>>::value>::type
-serialize_helper(T &val, std::fstream &fs) {
-    serialize_helper(val.get_all_member(), fs);
+constexpr size_t max_serialized_size(const options &opts = options()) {
+    static_assert(detail::fixed_size<T>::value, "binary: only fixed-shape types have a size bound");
+    size_t size = opts.compact ? detail::fixed_size<T>::bound : detail::fixed_size<T>::size;
+    if (!opts.compress && !opts.checksum) {
+        return size;
+    }
+    // a stored block is never larger than its bytes, every block and the end have a header
+    // and a checksum
+    size_t blocks = (size + compress::default_block_size - 1) / compress::default_block_size + 1;
+    return size + blocks * (sizeof(compress::block_header) + (opts.checksum ? sizeof(uint32_t) : 0));
 }
 
 template <typename T>
 typename std::enable_if<detail::is_not_user_type<std::remove_reference_t<T>>::value>::type
-serialize(T &&val, std::string file_name) {
+serialize(T &&val, std::string file_name, const options &opts = options()) {
     std::fstream fs(file_name, std::ios_base::out | std::ios_base::binary);
-    serialize_helper(std::forward<T>(val), fs);
+    serialize_to(val, fs, opts);
     fs.close();
 }
 
 template <typename T>
 typename std::enable_if<!detail::is_not_user_type<std::remove_reference_t<T>>::value &&
-                        detail::has_get_all_member<std::remove_reference_t<T>>::value>::type
-serialize(T &&val, std::string file_name) {
+                        (detail::has_get_all_member<std::remove_reference_t<T>>::value ||
+                         detail::is_trivially_serializable<std::remove_reference_t<T>>::value)>::type
+serialize(T &&val, std::string file_name, const options &opts = options()) {
     std::fstream fs(file_name, std::ios_base::out | std::ios_base::binary);
-    serialize_helper(val, fs);
+    serialize_to(val, fs, opts);
     fs.close();
 }
 
-template <typename T>
-typename std::enable_if<std::is_arithmetic_v<std::remove_reference_t<T>>>::type
-deserialize_helper(T &val, std::fstream &fs) {
-    fs.read(reinterpret_cast<char *>(&val), sizeof(T));
+/**
+ * front_coded_keys - the keys of a std::set<std::string> written by the compact format, read in
+ * place from a buffer like a std::string_view. A key is looked up by a binary search of the
+ * restart points, which decodes at most detail::restart_interval keys, so a large index is
+ * searched without being loaded. The buffer must outlive the view
+ */
+class front_coded_keys {
+public:
+    front_coded_keys() : block_(nullptr), bytes_(0), restarts_(nullptr), size_(0) {}
+
+    // the view of the size keys in the bytes of block, with the offsets of their restart points
+    front_coded_keys(const char *block, size_t bytes, const char *restarts, size_t size)
+        : block_(block), bytes_(bytes), restarts_(restarts), size_(size) {}
+
+    size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    /**
+     * at - the key i, decoded from the restart point before it
+     */
+    std::string at(size_t i) const {
+        if (i >= size_) {
+            throw std::out_of_range("binary::front_coded_keys: no such key");
+        }
+        std::string found;
+        scan(i / detail::restart_interval, [i, &found](size_t k, const std::string &key) {
+            if (k < i) {
+                return false;
+            }
+            found = key;
+            return true;
+        });
+        return found;
+    }
+
+    /**
+     * lower_bound - the index of the first key not less than key, size() when there is none
+     */
+    size_t lower_bound(std::string_view key) const {
+        bool equal;
+        return search(key, equal);
+    }
+
+    bool contains(std::string_view key) const {
+        bool equal;
+        search(key, equal);
+        return equal;
+    }
+
+private:
+    size_t restarts() const {
+        return (size_ + detail::restart_interval - 1) / detail::restart_interval;
+    }
+
+    size_t restart_offset(size_t r) const {
+        size_t width = detail::restart_width(bytes_);
+        uint64_t offset = 0;
+        for (size_t b = 0; b < width; b++) {
+            offset |= static_cast<uint64_t>(static_cast<uint8_t>(restarts_[r * width + b])) << (8 * b);
+        }
+        if (offset >= bytes_) {
+            throw std::invalid_argument("binary: corrupt front coded keys");
+        }
+        return static_cast<size_t>(offset);
+    }
+
+    // the key of the restart point r, which is written whole
+    std::string_view restart_key(size_t r) const {
+        size_t offset = restart_offset(r);
+        stream::memory_source source(block_ + offset, bytes_ - offset);
+        uint64_t shared = detail::read_varint(source);
+        uint64_t size = detail::read_varint(source);
+        if (shared != 0 || size > bytes_) {
+            throw std::invalid_argument("binary: corrupt front coded keys");
+        }
+        return std::string_view(source.borrow(size), size);
+    }
+
+    // decode the keys from the restart point r on, until visit(index, key) returns true
+    template <typename Visit>
+    void scan(size_t r, Visit &&visit) const {
+        size_t offset = restart_offset(r);
+        stream::memory_source source(block_ + offset, bytes_ - offset);
+        std::string key;
+        for (size_t i = r * detail::restart_interval; i < std::min(size_, (r + 1) * detail::restart_interval); i++) {
+            uint64_t shared = detail::read_varint(source);
+            uint64_t rest = detail::read_varint(source);
+            if (shared > key.size() || rest > bytes_) {
+                throw std::invalid_argument("binary: corrupt front coded keys");
+            }
+            key.resize(shared);
+            key.append(source.borrow(rest), rest);
+            if (visit(i, key)) {
+                return;
+            }
+        }
+    }
+
+    size_t search(std::string_view key, bool &equal) const {
+        equal = false;
+        // the first restart point whose key is not less than key
+        size_t low = 0, high = restarts();
+        while (low < high) {
+            size_t mid = low + (high - low) / 2;
+            if (restart_key(mid) < key) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        if (low < restarts() && restart_key(low) == key) {
+            equal = true;
+            return low * detail::restart_interval;
+        }
+        if (low == 0) {
+            return 0;
+        }
+        // the key falls after the restart point before, or right at the next one
+        size_t found = std::min(size_, low * detail::restart_interval);
+        scan(low - 1, [&key, &found, &equal](size_t i, const std::string &candidate) {
+            if (candidate < key) {
+                return false;
+            }
+            found = i;
+            equal = candidate == key;
+            return true;
+        });
+        return found;
+    }
+
+    const char *block_;
+    size_t bytes_;
+    const char *restarts_;
+    size_t size_;
+};
+
+} // namespace binary
+
+namespace detail {
+
+template <>
+struct is_view<binary::front_coded_keys> : std::true_type {};
+
+} // namespace detail
+
+namespace binary {
+
+template <typename T, typename Source>
+typename std::enable_if<std::is_arithmetic_v<std::remove_reference_t<T>> &&
+                        !detail::is_compact_integer<std::remove_reference_t<T>>::value>::type
+deserialize_helper(T &val, Source &source) {
+    detail::read_value(val, source);
 }
 
-template <typename T>
+template <typename T, typename Source>
+typename std::enable_if<detail::is_compact_integer<std::remove_reference_t<T>>::value>::type
+deserialize_helper(T &val, Source &source) {
+    if (detail::format_of(source).compact) {
+        val = detail::from_varint<T>(detail::read_varint(source));
+    } else {
+        detail::read_value(val, source);
+    }
+}
+
+template <typename T, typename Source>
 typename std::enable_if<!detail::is_not_user_type<std::remove_reference_t<T>>::value &&
-                        detail::has_get_all_member<std::remove_reference_t<T>>::value>::type
-deserialize_helper(T &val, std::fstream &fs);
+                        detail::has_get_all_member<std::remove_reference_t<T>>::value &&
+                        !detail::has_member_references<std::remove_reference_t<T>>::value &&
+                        !detail::is_trivially_serializable<std::remove_reference_t<T>>::value>::type
+deserialize_helper(T &val, Source &source);
 
-template <typename T>
+template <typename T, typename Source>
+typename std::enable_if<!detail::is_not_user_type<std::remove_reference_t<T>>::value &&
+                        detail::has_member_references<std::remove_reference_t<T>>::value &&
+                        !detail::is_trivially_serializable<std::remove_reference_t<T>>::value>::type
+deserialize_helper(T &val, Source &source);
+
+template <typename T, typename Source>
 typename std::enable_if<std::is_same_v<std::remove_reference_t<T>, std::string>>::type
-deserialize_helper(T &val, std::fstream &fs) {
-    int len;
-    fs.read(reinterpret_cast<char *>(&len), sizeof(int));
-    char s[len + 1];
-    fs.read(s, len);
-    s[len] = '\0';
-    val = T(s);
+deserialize_helper(T &val, Source &source) {
+    detail::read_string(val, source);
 }
 
-template <typename T>
+/*
+ * the views point into the buffer of source, which must outlive them. The string written by a
+ * std::string or a std::string_view can be read as either of them
+ */
+template <typename T, typename Source>
+typename std::enable_if<std::is_same_v<std::remove_reference_t<T>, std::string_view>>::type
+deserialize_helper(T &val, Source &source) {
+    detail::read_string(val, source);
+}
+
+/*
+ * the view borrows the block of the keys and their restart points from the buffer, the keys are
+ * not decoded until they are looked up
+ */
+template <typename T, typename Source>
+typename std::enable_if<std::is_same_v<std::remove_reference_t<T>, front_coded_keys>>::type
+deserialize_helper(T &val, Source &source) {
+    if (!detail::format_of(source).compact) {
+        throw std::invalid_argument("binary: front coded keys are only written by the compact format");
+    }
+    size_t size = detail::read_size(source);
+    size_t bytes = detail::read_size(source);
+    const char *block = detail::borrow(bytes, source);
+    size_t restarts = (size + detail::restart_interval - 1) / detail::restart_interval;
+    // every key takes 2 bytes of the block at least
+    if (restarts > bytes) {
+        throw std::invalid_argument("binary: corrupt front coded keys");
+    }
+    const char *offsets = detail::borrow(restarts * detail::restart_width(bytes), source);
+    val = front_coded_keys(block, bytes, offsets, size);
+}
+
+/*
+ * a span points to the raw numbers of a std::vector in the buffer of the source, which are only
+ * aligned for sure when they are written with options::aligned
+ */
+template <typename T, typename Source>
+typename std::enable_if<detail::is_span<std::remove_reference_t<T>>::value>::type
+deserialize_helper(T &val, Source &source) {
+    using element_type = typename std::remove_reference_t<T>::element_type;
+    static_assert(std::is_const_v<element_type>, "binary: only spans of const elements can be deserialized");
+    if (sizeof(element_type) > 1) {
+        detail::check_host_order(source);
+    }
+    if (detail::is_packed<std::remove_const_t<element_type>>(source)) {
+        throw std::invalid_argument("binary: spans cannot point to the numbers packed by the compact format or the XOR codec");
+    }
+    size_t size = detail::read_size(source);
+    if (detail::pads_elements<std::remove_const_t<element_type>>(source)) {
+        detail::read_padding(alignof(element_type), source);
+    }
+    const char *data = detail::borrow(sizeof(element_type) * size, source);
+    if (reinterpret_cast<uintptr_t>(data) % alignof(element_type) != 0) {
+        throw std::invalid_argument("binary: the buffer is not aligned for the elements of the span, write them with options::aligned");
+    }
+    val = T(reinterpret_cast<element_type *>(data), size);
+}
+
+template <typename T, typename Source>
 typename std::enable_if<detail::stl_container<std::remove_reference_t<T>>::value>::type
-deserialize_helper(T &val, std::fstream &fs);
+deserialize_helper(T &val, Source &source);
 
-template <typename T>
+template <typename T, typename Source>
 typename std::enable_if<detail::stl_container<std::remove_reference_t<T>>::value>::type
-deserialize_helper(T &val, std::fstream &fs) {
-    detail::deserialize_stl(val, fs);
+deserialize_helper(T &val, Source &source) {
+    detail::deserialize_stl(val, source);
 }
 
-template <typename T>
+template <typename T, typename Source>
 typename std::enable_if<!detail::is_not_user_type<std::remove_reference_t<T>>::value &&
-                        detail::has_get_all_member<std::remove_reference_t<T>>::value>::type
-deserialize_helper(T &val, std::fstream &fs) {
-    decltype(val.get_all_member()) tuple;
-    deserialize_helper(tuple, fs);
+                        detail::has_get_all_member<std::remove_reference_t<T>>::value &&
+                        !detail::has_member_references<std::remove_reference_t<T>>::value &&
+                        !detail::is_trivially_serializable<std::remove_reference_t<T>>::value>::type
+deserialize_helper(T &val, Source &source) {
+    std::decay_t<decltype(val.get_all_member())> tuple;
+    deserialize_helper(tuple, source);
     tuple_helper::construct_object(val, tuple);
 }
 
+template <typename T, typename Source>
+typename std::enable_if<!detail::is_not_user_type<std::remove_reference_t<T>>::value &&
+                        detail::has_member_references<std::remove_reference_t<T>>::value &&
+                        !detail::is_trivially_serializable<std::remove_reference_t<T>>::value>::type
+deserialize_helper(T &val, Source &source) {
+    auto members = val.get_all_member();
+    deserialize_helper(members, source);
+}
+
+template <typename T, typename Source>
+typename std::enable_if<detail::is_trivially_serializable<std::remove_reference_t<T>>::value>::type
+deserialize_helper(T &val, Source &source) {
+    detail::read_elements(&val, 1, source);
+}
+
+/**
+ * deserialize_from - reconstruct val from source with the format opts, source is any type with
+ * a member read(char *, size_t), like the sources in stream.h or std::fstream
+ */
+template <typename T, typename Source>
+typename std::enable_if<detail::is_not_user_type<std::remove_reference_t<T>>::value ||
+                        detail::has_get_all_member<std::remove_reference_t<T>>::value ||
+                        detail::is_trivially_serializable<std::remove_reference_t<T>>::value>::type
+deserialize_from(T &val, Source &source, const options &opts = options()) {
+    if constexpr (std::is_base_of_v<std::istream, Source>) {
+        // a failed read of a std::istream only sets its state, which the checked source turns
+        // into an exception
+        stream::istream_source checked(source);
+        deserialize_from(val, checked, opts);
+    } else if (opts.compress || opts.checksum) {
+        compress::block_source<Source> blocks(source, block_options_of(opts));
+        decoder<compress::block_source<Source>> dec(blocks, opts);
+        deserialize_helper(val, dec);
+        blocks.finish();
+    } else {
+        decoder<Source> dec(source, opts);
+        deserialize_helper(val, dec);
+    }
+}
+
 template <typename T>
 typename std::enable_if<detail::is_not_user_type<std::remove_reference_t<T>>::value>::type
-deserialize(T &val, std::string file_name) {
+deserialize(T &val, std::string file_name, const options &opts = options()) {
     std::fstream fs(file_name, std::ios_base::in | std::ios_base::binary);
-    deserialize_helper(val, fs);
+    deserialize_from(val, fs, opts);
     fs.close();
 }
 
 template <typename T>
 typename std::enable_if<!detail::is_not_user_type<std::remove_reference_t<T>>::value &&
-                        detail::has_get_all_member<std::remove_reference_t<T>>::value>::type
-deserialize(T &val, std::string file_name) {
+                        (detail::has_get_all_member<std::remove_reference_t<T>>::value ||
+                         detail::is_trivially_serializable<std::remove_reference_t<T>>::value)>::type
+deserialize(T &val, std::string file_name, const options &opts = options()) {
     std::fstream fs(file_name, std::ios_base::in | std::ios_base::binary);
-    deserialize_helper(val, fs);
+    deserialize_from(val, fs, opts);
     fs.close();
 }
 
+/**
+ * deserialize_mapped - reconstruct val from the file file_name through a memory mapping instead
+ * of a std::fstream, with populate set the whole file is faulted in up front. The file is unmapped
+ * on return, so views are read from a stream::mmap_source which outlives them instead
+ */
+template <typename T>
+typename std::enable_if<detail::is_not_user_type<std::remove_reference_t<T>>::value ||
+                        detail::has_get_all_member<std::remove_reference_t<T>>::value ||
+                        detail::is_trivially_serializable<std::remove_reference_t<T>>::value>::type
+deserialize_mapped(T &val, std::string file_name, const options &opts = options(), bool populate = false) {
+    static_assert(!detail::holds_view<std::remove_cv_t<std::remove_reference_t<T>>>::value,
+                  "binary: views would outlive the mapping, deserialize them from a stream::mmap_source");
+    stream::mmap_source source(file_name, populate);
+    deserialize_from(val, source, opts);
+}
+
+/**
+ * writer - serialize many objects one after another into a single file, which stays open until
+ * the writer is destroyed. The objects are buffered and written by flush() or the destructor
+ */
+class writer {
+public:
+    explicit writer(const std::string &file_name, const options &opts = options())
+        : fd_(open_file(file_name)), sink_(fd_), enc_(sink_, opts) {
+        // the objects written later may point to the shared objects of the earlier ones
+        enc_.keep_shared();
+        if (opts.compress || opts.checksum) {
+            blocks_.emplace(sink_, block_options_of(opts));
+            block_enc_.emplace(*blocks_, opts);
+            block_enc_->keep_shared();
+        }
+    }
+
+    writer(const writer &) = delete;
+    writer &operator=(const writer &) = delete;
+
+    ~writer() {
+        try {
+            if (blocks_) {
+                blocks_->finish();
+            }
+            sink_.flush();
+        } catch (...) {
+        }
+        // the threads of the block stage write to the file until they are stopped
+        block_enc_.reset();
+        blocks_.reset();
+        ::close(fd_);
+    }
+
+    template <typename T>
+    typename std::enable_if<detail::is_not_user_type<std::remove_reference_t<T>>::value ||
+                            detail::has_get_all_member<std::remove_reference_t<T>>::value ||
+                            detail::is_trivially_serializable<std::remove_reference_t<T>>::value>::type
+    write(T &&val) {
+        if (block_enc_) {
+            serialize_helper(val, *block_enc_);
+        } else {
+            serialize_helper(val, enc_);
+        }
+    }
+
+    /**
+     * flush - write the buffered objects to the file, a partial block is compressed on its own
+     */
+    void flush() {
+        if (blocks_) {
+            blocks_->flush();
+        }
+        sink_.flush();
+    }
+
+    /**
+     * reserve - allocate the next n bytes of the file up front, like serialized_size of the
+     * objects about to be written, so the file system does not extend the file write by write.
+     * The size of the file is kept, so over-reserving for compressed objects leaves no trailing bytes.
+     * The block stage is flushed first, so its threads are idle and the space starts behind every
+     * block of the objects written so far
+     */
+    void reserve(size_t n) {
+        if (blocks_) {
+            blocks_->flush();
+        }
+        if (::fallocate(fd_, FALLOC_FL_KEEP_SIZE, sink_.size(), n) < 0 && errno != EOPNOTSUPP) {
+            throw std::system_error(errno, std::generic_category(), "binary::writer");
+        }
+    }
+
+private:
+    static int open_file(const std::string &file_name) {
+        int fd = ::open(file_name.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "binary::writer: " + file_name);
+        }
+        return fd;
+    }
+
+    int fd_;
+    stream::fd_sink sink_;
+    encoder<stream::fd_sink> enc_;
+    std::optional<compress::block_sink<stream::fd_sink>> blocks_;
+    std::optional<encoder<compress::block_sink<stream::fd_sink>>> block_enc_;
+};
+
+/**
+ * reader - deserialize the objects written by a writer in the order they were written, from a
+ * file which stays open until the reader is destroyed
+ */
+class reader {
+public:
+    explicit reader(const std::string &file_name, const options &opts = options())
+        : fd_(open_file(file_name)), source_(fd_), dec_(source_, opts) {
+        if (opts.compress || opts.checksum) {
+            blocks_.emplace(source_, block_options_of(opts));
+            block_dec_.emplace(*blocks_, opts);
+        }
+    }
+
+    reader(const reader &) = delete;
+    reader &operator=(const reader &) = delete;
+
+    ~reader() {
+        block_dec_.reset();
+        blocks_.reset();
+        ::close(fd_);
+    }
+
+    template <typename T>
+    typename std::enable_if<detail::is_not_user_type<std::remove_reference_t<T>>::value ||
+                            detail::has_get_all_member<std::remove_reference_t<T>>::value ||
+                            detail::is_trivially_serializable<std::remove_reference_t<T>>::value>::type
+    read(T &val) {
+        if (block_dec_) {
+            deserialize_helper(val, *block_dec_);
+        } else {
+            deserialize_helper(val, dec_);
+        }
+    }
+
+private:
+    static int open_file(const std::string &file_name) {
+        int fd = ::open(file_name.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "binary::reader: " + file_name);
+        }
+        return fd;
+    }
+
+    int fd_;
+    stream::fd_source source_;
+    decoder<stream::fd_source> dec_;
+    std::optional<compress::block_source<stream::fd_source>> blocks_;
+    std::optional<decoder<compress::block_source<stream::fd_source>>> block_dec_;
+};
+
 } // namespace binary
 
 namespace detail {
 
 template <typename T>
+size_t count_serialized(T &val, const binary::options &opts) {
+    stream::counting_sink counter;
+    // serialization only reads val, the entry points just do not take const objects
+    binary::serialize_to(const_cast<std::remove_const_t<T> &>(val), counter, opts);
+    return counter.size();
+}
+
+template <typename T, typename Sink>
 typename std::enable_if<is_tuple<std::remove_reference_t<T>>::value>::type
-serialize_stl(T &&val, std::fstream &fs) {
-    tuple_helper::tuple_for_each([&fs](auto &&val) { binary::serialize_helper(std::forward<decltype(val)>(val), fs); },
+serialize_stl(T &&val, Sink &sink) {
+    tuple_helper::tuple_for_each([&sink](auto &&val) { binary::serialize_helper(std::forward<decltype(val)>(val), sink); },
                                  val);
 }
 
+/**
+ * write_sequence - write the n elements from it one after another, integers are packed by the
+ * compact format
+ */
+template <typename T, typename Iterator, typename Sink>
+typename std::enable_if<!is_compact_integer<T>::value>::type
+write_sequence(Iterator it, size_t n, Sink &sink) {
+    for (size_t i = 0; i < n; i++, ++it) {
+        binary::serialize_helper(*it, sink);
+    }
+}
+
+template <typename T, typename Iterator, typename Sink>
+typename std::enable_if<is_compact_integer<T>::value>::type
+write_sequence(Iterator it, size_t n, Sink &sink) {
+    if (format_of(sink).compact) {
+        write_packed<T>(it, n, sink);
+        return;
+    }
+    for (size_t i = 0; i < n; i++, ++it) {
+        binary::serialize_helper(*it, sink);
+    }
+}
+
+/**
+ * read_sequence - read n elements written by write_sequence and pass each of them to f
+ */
+template <typename T, typename Source, typename Func>
+typename std::enable_if<!is_compact_integer<T>::value>::type
+read_sequence(size_t n, Source &source, Func &&f) {
+    for (size_t i = 0; i < n; i++) {
+        T value;
+        binary::deserialize_helper(value, source);
+        f(std::move(value));
+    }
+}
+
+template <typename T, typename Source, typename Func>
+typename std::enable_if<is_compact_integer<T>::value>::type
+read_sequence(size_t n, Source &source, Func &&f) {
+    if (format_of(source).compact) {
+        read_packed<T>(n, source, [&f](const packed_word<T> *values, size_t m) {
+            for (size_t i = 0; i < m; i++) {
+                f(from_varint<T>(values[i]));
+            }
+        });
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        T value;
+        binary::deserialize_helper(value, source);
+        f(std::move(value));
+    }
+}
+
+/**
+ * read_sequence_into - read n elements written by write_sequence, each one into the object
+ * next() returns, which is then passed to done(). The objects keep their storage
+ */
+template <typename T, typename Source, typename Next, typename Done>
+typename std::enable_if<!is_compact_integer<T>::value>::type
+read_sequence_into(size_t n, Source &source, Next &&next, Done &&done) {
+    for (size_t i = 0; i < n; i++) {
+        T &value = next();
+        binary::deserialize_helper(value, source);
+        done(value);
+    }
+}
+
+template <typename T, typename Source, typename Next, typename Done>
+typename std::enable_if<is_compact_integer<T>::value>::type
+read_sequence_into(size_t n, Source &source, Next &&next, Done &&done) {
+    if (format_of(source).compact) {
+        read_packed<T>(n, source, [&next, &done](const packed_word<T> *values, size_t m) {
+            for (size_t i = 0; i < m; i++) {
+                T &value = next();
+                value = from_varint<T>(values[i]);
+                done(value);
+            }
+        });
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        T &value = next();
+        binary::deserialize_helper(value, source);
+        done(value);
+    }
+}
+
+template <typename Source>
+void skip_bytes(size_t n, Source &source) {
+    if constexpr (has_skip<Source>::value) {
+        source.skip(n);
+    } else if constexpr (has_borrow<Source>::value) {
+        source.borrow(n);
+    } else {
+        char scratch[4096];
+        for (size_t m; n > 0; n -= m) {
+            m = std::min(n, sizeof(scratch));
+            source.read(scratch, m);
+        }
+    }
+}
+
+/**
+ * write_front_coded - write the n sorted strings key(*it), which are encoded into a block first
+ * so the container is walked once
+ */
+template <typename Iterator, typename Key, typename Sink>
+void write_front_coded(Iterator it, size_t n, Key &&key, Sink &sink) {
+    std::vector<char> block;
+    std::vector<uint64_t> restarts;
+    restarts.reserve((n + restart_interval - 1) / restart_interval);
+    std::string_view prev;
+    char buf[2 * codec::max_varint_size];
+    for (size_t i = 0; i < n; i++, ++it) {
+        std::string_view cur = key(*it);
+        size_t shared = 0;
+        if (i % restart_interval == 0) {
+            restarts.push_back(block.size());
+        } else {
+            shared = shared_prefix(prev, cur);
+        }
+        size_t len = codec::encode_varint(shared, buf);
+        len += codec::encode_varint(cur.size() - shared, buf + len);
+        block.insert(block.end(), buf, buf + len);
+        block.insert(block.end(), cur.data() + shared, cur.data() + cur.size());
+        prev = cur;
+    }
+    write_size(block.size(), sink);
+    sink.write(block.data(), block.size());
+    size_t width = restart_width(block.size());
+    for (uint64_t restart : restarts) {
+        for (size_t b = 0; b < width; b++) {
+            buf[b] = static_cast<char>(restart >> (8 * b));
+        }
+        sink.write(buf, width);
+    }
+}
+
+/**
+ * read_front_coded - read n strings written by write_front_coded into the strings next() returns,
+ * done is called with every string read. A string holds the prefix of the next one, so it must
+ * stay in place until that one is read, and the strings are rebuilt in the storage they have
+ */
+template <typename Source, typename Next, typename Done>
+void read_front_coded(size_t n, Source &source, Next &&next, Done &&done) {
+    size_t bytes = read_size(source);
+    size_t start = source.position();
+    const std::string *prev = nullptr;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t shared = read_varint(source);
+        uint64_t rest = read_varint(source);
+        size_t used = source.position() - start;
+        if ((i % restart_interval == 0 ? shared != 0 : shared > prev->size()) || used > bytes || rest > bytes - used) {
+            throw std::invalid_argument("binary: corrupt front coded keys");
+        }
+        std::string &key = next();
+        key.resize(shared + rest);
+        if (shared > 0) {
+            std::memcpy(&key[0], prev->data(), shared);
+        }
+        source.read(&key[shared], rest);
+        done(key);
+        prev = &key;
+    }
+    if (source.position() - start != bytes) {
+        throw std::invalid_argument("binary: corrupt front coded keys");
+    }
+    skip_bytes((n + restart_interval - 1) / restart_interval * restart_width(bytes), source);
+}
+
+// the keys which the compact format writes sorted, integers as gaps and strings front coded
+template <typename T>
+struct is_sorted_key : std::integral_constant<bool, is_compact_integer<T>::value || std::is_same_v<T, std::string>> {};
+
+template <typename T>
+struct has_sorted_keys : std::false_type {};
+
+template <typename T>
+struct has_sorted_keys<std::set<T>> : is_sorted_key<T> {};
+
+template <typename T1, typename T2>
+struct has_sorted_keys<std::map<T1, T2>> : is_sorted_key<T1> {};
+
+template <typename T, typename Iterator, typename Key, typename Sink>
+void write_keys(Iterator it, size_t n, Key &&key, Sink &sink) {
+    if constexpr (is_compact_integer<T>::value) {
+        write_ascending<T>(it, n, key, sink);
+    } else {
+        write_front_coded(it, n, key, sink);
+    }
+}
+
+/**
+ * read_keys - read n keys written by write_keys into the keys next() returns, done is called with
+ * every key read. A key must stay in place until the next one is read
+ */
+template <typename T, typename Source, typename Next, typename Done>
+void read_keys(size_t n, Source &source, Next &&next, Done &&done) {
+    if constexpr (is_compact_integer<T>::value) {
+        read_ascending<T>(n, source, [&next, &done](const T *values, size_t m) {
+            for (size_t i = 0; i < m; i++) {
+                T &key = next();
+                key = values[i];
+                done(key);
+            }
+        });
+    } else {
+        read_front_coded(n, source, next, done);
+    }
+}
+
+/**
+ * take_node - a node of val to be refilled, or a new one when val has none left
+ */
+template <typename Container>
+typename Container::node_type take_node(Container &val) {
+    if (val.empty()) {
+        Container fresh;
+        return fresh.extract(fresh.emplace().first);
+    }
+    return val.extract(val.begin());
+}
+
+/**
+ * insert_key - insert the node with a key read by read_keys at the end of val, sorted keys are
+ * distinct so one which is there already is corrupt
+ */
+template <typename Container>
+void insert_key(Container &val, typename Container::node_type &node) {
+    val.insert(val.end(), std::move(node));
+    if (node) {
+        throw std::invalid_argument("binary: corrupt sorted keys");
+    }
+}
+
+template <typename T, typename Sink>
+void write_sorted_keys(std::set<T> &val, Sink &sink) {
+    write_keys<T>(val.begin(), val.size(), [](const T &key) -> const T & { return key; }, sink);
+}
+
+// the keys come first and the values after them
+template <typename T1, typename T2, typename Sink>
+void write_sorted_keys(std::map<T1, T2> &val, Sink &sink) {
+    write_keys<T1>(val.begin(), val.size(), [](const std::pair<const T1, T2> &entry) -> const T1 & { return entry.first; },
+                   sink);
+    for (auto &entry : val) {
+        binary::serialize_helper(entry.second, sink);
+    }
+}
+
+/*
+ * the columnar format writes a std::vector of a user type member by member: its size, then for
+ * every member of get_all_member the byte length of its column and the column, that member of
+ * all the elements. A column of numbers is a block like a std::vector of them, packed by the
+ * compact format, and a reader skips the columns it does not need by their lengths
+ */
 template <typename T>
+struct is_columnar_vector : std::false_type {};
+
+template <typename T>
+struct is_columnar_vector<std::vector<T>> : is_columnar_element<T> {};
+
+// the numbers of a column are copied through a buffer of column_chunk, a multiple of
+// packed_chunk so the packed chunks are the same as the ones of a whole std::vector
+constexpr size_t column_chunk = 4 * packed_chunk;
+
+template <typename T>
+using member_tuple = std::decay_t<decltype(std::declval<T &>().get_all_member())>;
+
+template <size_t K, typename T>
+using column_type = std::decay_t<std::tuple_element_t<K, member_tuple<T>>>;
+
+/**
+ * column_member - the member K of a row of the columns, which is an element itself when its
+ * get_all_member returns references to its members, and a tuple of copies of them otherwise
+ */
+template <size_t K, typename Row>
+decltype(auto) column_member(Row &row) {
+    if constexpr (is_tuple<Row>::value) {
+        return std::get<K>(row);
+    } else {
+        return std::get<K>(row.get_all_member());
+    }
+}
+
+template <size_t K, typename T, typename Rows, typename Sink>
+void write_column(Rows &rows, Sink &sink) {
+    using member = column_type<K, T>;
+    if constexpr (is_bulk_element<member>::value) {
+        std::vector<member> chunk(std::min(rows.size(), column_chunk));
+        for (size_t first = 0; first < rows.size(); first += column_chunk) {
+            size_t m = std::min(column_chunk, rows.size() - first);
+            for (size_t i = 0; i < m; i++) {
+                chunk[i] = column_member<K>(rows[first + i]);
+            }
+            write_elements(chunk.data(), m, sink);
+        }
+    } else {
+        for (auto &row : rows) {
+            binary::serialize_helper(column_member<K>(row), sink);
+        }
+    }
+}
+
+/**
+ * column_scope - a dictionary of strings of its own for the encoder or decoder coder while the
+ * scope lives, so a column read or skipped alone does not need the strings of the others. Columns
+ * are encoded apart from the stream, so options::aligned does not pad the vectors in them
+ */
+template <typename Coder>
+class column_scope {
+public:
+    explicit column_scope(Coder &coder) : coder_(coder), aligned_(coder.format().aligned) {
+        if (coder_.format().string_dictionary) {
+            strings_ = binary::take_spare_table<typename Coder::string_table>();
+        }
+        coder_.swap_strings(strings_);
+        coder_.set_aligned(false);
+    }
+
+    ~column_scope() {
+        coder_.swap_strings(strings_);
+        coder_.set_aligned(aligned_);
+        if (coder_.format().string_dictionary) {
+            binary::give_spare_table(strings_);
+        }
+    }
+
+    column_scope(const column_scope &) = delete;
+    column_scope &operator=(const column_scope &) = delete;
+
+private:
+    Coder &coder_;
+    bool aligned_;
+    typename Coder::string_table strings_;
+};
+
+/**
+ * write_column_at - write the byte length of the column K and the column. The length of numbers
+ * is known unless they are packed, other columns are encoded into scratch first. The ids of
+ * shared objects depend on the ones written before, so their columns are measured by a counting
+ * pass going on from the stream instead
+ */
+template <size_t K, typename T, typename Rows, typename Sink>
+void write_column_at(Rows &rows, std::vector<char> &scratch, Sink &sink) {
+    using member = column_type<K, T>;
+    static_assert(!is_view<member>::value, "binary: views cannot be written in columns");
+    column_scope<Sink> scope(sink);
+    if constexpr (is_bulk_element<member>::value) {
+        if (!is_packed<member>(sink)) {
+            write_size(rows.size() * sizeof(member), sink);
+            write_column<K, T>(rows, sink);
+            return;
+        }
+    }
+    if constexpr (holds_shared<member>::value) {
+        stream::counting_sink counter;
+        binary::encoder<stream::counting_sink> enc(counter, sink);
+        write_column<K, T>(rows, enc);
+        write_size(counter.size(), sink);
+        write_column<K, T>(rows, sink);
+    } else {
+        scratch.clear();
+        stream::memory_sink buffer(scratch);
+        binary::encoder<stream::memory_sink> enc(buffer, sink);
+        write_column<K, T>(rows, enc);
+        write_size(scratch.size(), sink);
+        sink.write(scratch.data(), scratch.size());
+    }
+}
+
+template <typename T, typename Rows, typename Sink, int... K>
+void write_columns(Rows &rows, Sink &sink, tuple_helper::IndexTuple<K...>) {
+    std::vector<char> scratch;
+    (write_column_at<K, T>(rows, scratch, sink), ...);
+}
+
+template <typename Vector, typename Sink>
+void write_columns(Vector &val, Sink &sink) {
+    using T = typename Vector::value_type;
+    using column_index = typename tuple_helper::MakeIndex<std::tuple_size_v<member_tuple<T>>>::tuple_index;
+    write_size(val.size(), sink);
+    if constexpr (has_member_references<T>::value) {
+        write_columns<T>(val, sink, column_index());
+    } else {
+        // get_all_member copies all the members, so it is called once per element
+        std::vector<member_tuple<T>> rows;
+        rows.reserve(val.size());
+        for (auto &element : val) {
+            rows.push_back(element.get_all_member());
+        }
+        write_columns<T>(rows, sink, column_index());
+    }
+}
+
+template <size_t K, typename T, typename Rows, typename Source>
+void read_column(Rows &rows, size_t first, size_t n, Source &source) {
+    using member = column_type<K, T>;
+    if constexpr (is_bulk_element<member>::value) {
+        std::vector<member> chunk(std::min(n, column_chunk));
+        for (size_t done = 0; done < n; done += column_chunk) {
+            size_t m = std::min(column_chunk, n - done);
+            read_elements(chunk.data(), m, source);
+            for (size_t i = 0; i < m; i++) {
+                column_member<K>(rows[first + done + i]) = chunk[i];
+            }
+        }
+    } else {
+        for (size_t i = first; i < first + n; i++) {
+            binary::deserialize_helper(column_member<K>(rows[i]), source);
+        }
+    }
+}
+
+/**
+ * read_column_at - read or skip the column K of size rows. The first column sizes the rows, as
+ * it is read in steps like read_growing or after it is skipped, so a corrupt size runs out of
+ * stream before it allocates
+ */
+template <size_t K, typename T, typename Rows, typename Source>
+void read_column_at(Rows &rows, size_t size, Source &source) {
+    using member = column_type<K, T>;
+    size_t bytes = read_size(source);
+    size_t start = source.position();
+    column_scope<Source> scope(source);
+    if (K < 64 && !(format_of(source).column_mask >> K & 1) && !holds_shared<member>::value) {
+        skip_bytes(bytes, source);
+        if (K == 0) {
+            // every element takes a byte of the column at least, or a bit of XOR-compressed ones
+            if (size / (is_packed<member>(source) && is_xor_float<member>::value ? 8 : 1) > bytes && !(fixed_size<member>::value && fixed_size<member>::size == 0)) {
+                throw std::invalid_argument("binary: corrupt columns");
+            }
+            rows.resize(size);
+        }
+        return;
+    }
+    if (K > 0) {
+        read_column<K, T>(rows, 0, size, source);
+    } else {
+        size_t done = 0;
+        size_t next = std::min(size, std::max(column_chunk, prealloc_count<typename Rows::value_type>(size) /
+                                                                column_chunk * column_chunk));
+        for (;;) {
+            if (rows.size() < next) {
+                rows.resize(next);
+            }
+            read_column<K, T>(rows, done, next - done, source);
+            done = next;
+            if (done == size) {
+                break;
+            }
+            next = std::min(size, 2 * done);
+        }
+        rows.resize(size);
+    }
+    if (source.position() - start != bytes) {
+        throw std::invalid_argument("binary: the length of a column does not match");
+    }
+}
+
+template <typename T, typename Rows, typename Source, int... K>
+void read_columns(Rows &rows, size_t size, Source &source, tuple_helper::IndexTuple<K...>) {
+    (read_column_at<K, T>(rows, size, source), ...);
+}
+
+template <typename T, typename Source>
+void read_columns(std::vector<T> &val, Source &source) {
+    using column_index = typename tuple_helper::MakeIndex<std::tuple_size_v<member_tuple<T>>>::tuple_index;
+    size_t size = read_size(source);
+    if constexpr (has_member_references<T>::value) {
+        // the members are read in place, the elements there are kept with reuse
+        if (!format_of(source).reuse) {
+            val.clear();
+        }
+        read_columns<T>(val, size, source, column_index());
+    } else {
+        std::vector<member_tuple<T>> rows;
+        read_columns<T>(rows, size, source, column_index());
+        val.resize(rows.size());
+        for (size_t i = 0; i < rows.size(); i++) {
+            tuple_helper::construct_object(val[i], rows[i]);
+        }
+    }
+}
+
+template <typename T, typename Sink>
 typename std::enable_if<!is_pair<std::remove_reference_t<T>>::value &&
                         !is_tuple<std::remove_reference_t<T>>::value &&
-                        !is_smart_ptr<std::remove_reference_t<T>>::value>::type
-serialize_stl(T &&val, std::fstream &fs) {
-    int len = val.size();
-    binary::serialize_helper(len, fs);
-    for (auto &v : val) {
-        binary::serialize_helper(v, fs);
+                        !is_smart_ptr<std::remove_reference_t<T>>::value &&
+                        !is_std_array<std::remove_reference_t<T>>::value &&
+                        !is_bulk_container<std::remove_reference_t<T>>::value>::type
+serialize_stl(T &&val, Sink &sink) {
+    using value_type = typename std::remove_reference_t<T>::value_type;
+    if constexpr (is_columnar_vector<std::remove_cv_t<std::remove_reference_t<T>>>::value && has_format<Sink>::value) {
+        if (format_of(sink).columnar) {
+            write_columns(val, sink);
+            return;
+        }
     }
+    if constexpr (has_sorted_keys<std::remove_cv_t<std::remove_reference_t<T>>>::value) {
+        if (format_of(sink).compact) {
+            write_size(val.size(), sink);
+            write_sorted_keys(val, sink);
+            return;
+        }
+    }
+    write_size(val.size(), sink);
+    write_sequence<value_type>(val.begin(), val.size(), sink);
 }
 
-template <typename T>
+// the elements are stored back to back, so the whole payload is written with a single call
+template <typename T, typename Sink>
+typename std::enable_if<is_bulk_container<std::remove_reference_t<T>>::value>::type
+serialize_stl(T &&val, Sink &sink) {
+    using value_type = typename std::remove_reference_t<T>::value_type;
+    write_size(val.size(), sink);
+    if (pads_elements<value_type>(sink)) {
+        write_padding(alignof(value_type), sink);
+    }
+    write_elements(val.data(), val.size(), sink);
+}
+
+template <typename T, typename Sink>
 typename std::enable_if<is_pair<std::remove_reference_t<T>>::value>::type
-serialize_stl(T &&val, std::fstream &fs) {
-    binary::serialize_helper(val.first, fs);
-    binary::serialize_helper(val.second, fs);
+serialize_stl(T &&val, Sink &sink) {
+    binary::serialize_helper(val.first, sink);
+    binary::serialize_helper(val.second, sink);
 }
 
-template <typename T>
+// a std::unique_ptr owns its object alone, so a byte telling whether it is null is enough
+template <typename T, typename Sink>
+void write_pointer(const std::unique_ptr<T> &val, Sink &sink) {
+    write_value(static_cast<uint8_t>(val != nullptr), sink);
+    if (val) {
+        binary::serialize_helper(*val, sink);
+    }
+}
+
+/*
+ * a std::shared_ptr is written as a size tag: 0 for null, 1 for an object written right after
+ * it and 2 + id for the object with the id written before. So an object is written once however
+ * many pointers share it, and the pointers read back share it again, cycles closed by a
+ * std::weak_ptr included
+ */
+template <typename T, typename Sink>
+void write_pointer(const std::shared_ptr<T> &val, Sink &sink) {
+    if (!val) {
+        write_size(0, sink);
+        return;
+    }
+    auto [id, written] = sink.track_shared(val, binary::type_id<std::remove_cv_t<T>>::get());
+    if (written) {
+        write_size(2 + id, sink);
+        return;
+    }
+    write_size(1, sink);
+    binary::serialize_helper(*val, sink);
+}
+
+// an expired std::weak_ptr is written as null
+template <typename T, typename Sink>
+void write_pointer(const std::weak_ptr<T> &val, Sink &sink) {
+    write_pointer(val.lock(), sink);
+}
+
+template <typename T, typename Sink>
 typename std::enable_if<is_smart_ptr<std::remove_reference_t<T>>::value>::type
-serialize_stl(T &&val, std::fstream &fs) {
-    binary::serialize_helper(*val, fs);
+serialize_stl(T &&val, Sink &sink) {
+    write_pointer(val, sink);
 }
 
-template <typename T1, typename T2>
-void deserialize_stl(std::pair<T1, T2> &val, std::fstream &fs) {
-    binary::deserialize_helper(val.first, fs);
-    binary::deserialize_helper(val.second, fs);
+template <typename T, typename Sink>
+typename std::enable_if<is_std_array<std::remove_reference_t<T>>::value>::type
+serialize_stl(T &&val, Sink &sink) {
+    using value_type = typename std::remove_reference_t<T>::value_type;
+    if constexpr (is_xor_float<value_type>::value) {
+        // the size of a std::array does not depend on the options but the compact format
+        write_raw(val.data(), val.size(), sink);
+    } else if constexpr (is_bulk_container<std::vector<value_type>>::value) {
+        write_elements(val.data(), val.size(), sink);
+    } else {
+        write_sequence<value_type>(val.begin(), val.size(), sink);
+    }
 }
 
-template <typename T1, typename T2>
-void deserialize_stl(std::map<T1, T2> &val, std::fstream &fs) {
-    int size;
-    binary::deserialize_helper(size, fs);
-    for (int i = 0; i < size; i++) {
-        std::pair<T1, T2> value;
-        binary::deserialize_helper(value, fs);
-        val.emplace(std::move(value));
+template <typename T1, typename T2, typename Source>
+void deserialize_stl(std::pair<T1, T2> &val, Source &source) {
+    binary::deserialize_helper(val.first, source);
+    binary::deserialize_helper(val.second, source);
+}
+
+template <typename T1, typename T2, typename Source>
+void deserialize_stl(std::map<T1, T2> &val, Source &source) {
+    size_t size = read_size(source);
+    if constexpr (is_sorted_key<T1>::value && has_format<Source>::value) {
+        if (format_of(source).compact) {
+            if (!format_of(source).reuse) {
+                val.clear();
+            }
+            // the keys are read into the nodes left in val before any is allocated, and the values
+            // after them in the same order
+            std::map<T1, T2> entries;
+            typename std::map<T1, T2>::node_type node;
+            read_keys<T1>(size, source, [&val, &node]() -> T1 & {
+                node = take_node(val);
+                return node.key();
+            }, [&entries, &node](T1 &) {
+                insert_key(entries, node);
+            });
+            for (auto &entry : entries) {
+                binary::deserialize_helper(entry.second, source);
+            }
+            val.swap(entries);
+            return;
+        }
     }
+    if (format_of(source).reuse) {
+        // the nodes of val are taken one by one and refilled, so no node is allocated while
+        // there are old ones left
+        std::map<T1, T2> entries;
+        for (size_t i = 0; i < size; i++) {
+            if (val.empty()) {
+                std::pair<T1, T2> value;
+                binary::deserialize_helper(value, source);
+                entries.emplace_hint(entries.end(), std::move(value));
+                continue;
+            }
+            auto node = val.extract(val.begin());
+            binary::deserialize_helper(node.key(), source);
+            binary::deserialize_helper(node.mapped(), source);
+            entries.insert(entries.end(), std::move(node));
+        }
+        val.swap(entries);
+        return;
+    }
+    val.clear();
+    // the entries were written in order, so each one goes right before end
+    read_sequence<std::pair<T1, T2>>(size, source, [&val](std::pair<T1, T2> &&value) {
+        val.emplace_hint(val.end(), std::move(value));
+    });
 }
 
-template <typename T>
-void deserialize_stl(std::set<T> &val, std::fstream &fs) {
-    int size;
-    binary::deserialize_helper(size, fs);
-    for (int i = 0; i < size; i++) {
+template <typename T, typename Source>
+void deserialize_stl(std::set<T> &val, Source &source) {
+    size_t size = read_size(source);
+    if constexpr (is_sorted_key<T>::value && has_format<Source>::value) {
+        if (format_of(source).compact) {
+            if (!format_of(source).reuse) {
+                val.clear();
+            }
+            std::set<T> keys;
+            typename std::set<T>::node_type node;
+            read_keys<T>(size, source, [&val, &node]() -> T & {
+                node = take_node(val);
+                return node.value();
+            }, [&keys, &node](T &) {
+                insert_key(keys, node);
+            });
+            val.swap(keys);
+            return;
+        }
+    }
+    if (format_of(source).reuse) {
+        std::set<T> keys;
+        typename std::set<T>::node_type node;
         T value;
-        binary::deserialize_helper(value, fs);
-        val.emplace(std::move(value));
+        read_sequence_into<T>(size, source,
+                              [&val, &node, &value]() -> T & {
+                                  if (val.empty()) {
+                                      return value;
+                                  }
+                                  node = val.extract(val.begin());
+                                  return node.value();
+                              },
+                              [&keys, &node](T &value) {
+                                  if (node) {
+                                      keys.insert(keys.end(), std::move(node));
+                                  } else {
+                                      keys.emplace_hint(keys.end(), std::move(value));
+                                  }
+                              });
+        val.swap(keys);
+        return;
     }
+    val.clear();
+    read_sequence<T>(size, source, [&val](T &&value) {
+        val.emplace_hint(val.end(), std::move(value));
+    });
 }
 
-template <typename T>
-void deserialize_stl(std::vector<T> &val, std::fstream &fs) {
-    int size;
-    binary::deserialize_helper(size, fs);
-    for (int i = 0; i < size; i++) {
-        T value;
-        binary::deserialize_helper(value, fs);
+template <typename T, typename Source>
+typename std::enable_if<!is_bulk_container<std::vector<T>>::value>::type
+deserialize_stl(std::vector<T> &val, Source &source) {
+    if constexpr (is_columnar_element<T>::value && has_format<Source>::value) {
+        if (format_of(source).columnar) {
+            read_columns(val, source);
+            return;
+        }
+    }
+    size_t size = read_size(source);
+    // the elements of std::vector<bool> are bits, which cannot be read in place
+    if constexpr (!std::is_same_v<T, bool>) {
+        if (format_of(source).reuse) {
+            // the elements there are refilled, and the ones past them appended as they are read
+            size_t kept = std::min(size, val.size());
+            val.resize(kept);
+            size_t i = 0;
+            read_sequence_into<T>(size, source,
+                                  [&val, &i, kept]() -> T & { return i < kept ? val[i++] : val.emplace_back(); },
+                                  [](T &) {});
+            return;
+        }
+    }
+    val.clear();
+    val.reserve(prealloc_count<T>(size, source, 8));
+    read_sequence<T>(size, source, [&val](T &&value) {
         val.emplace_back(std::move(value));
+    });
+}
+
+template <typename T, typename Source>
+typename std::enable_if<is_bulk_container<std::vector<T>>::value>::type
+deserialize_stl(std::vector<T> &val, Source &source) {
+    size_t size = read_size(source);
+    if constexpr (is_trivially_serializable<T>::value) {
+        read_layout<T>(source);
+        size_t count = prealloc_count<T>(size, source, 8 * sizeof(T));
+        read_growing(val, size, count, [&val, &source](size_t first, size_t n) {
+            source.read(reinterpret_cast<char *>(val.data() + first), sizeof(T) * n);
+        });
+    } else {
+        if (pads_elements<T>(source)) {
+            read_padding(alignof(T), source);
+        }
+        // the compact format takes a byte for a number at least and the XOR codec a bit.
+        // max_prealloc is a multiple of packed_chunk numbers, so when val grows the packed
+        // formats are split where their chunks end
+        size_t min_bits = !is_packed<T>(source) ? 8 * sizeof(T) : is_xor_float<T>::value ? 1 : 8;
+        size_t count = prealloc_count<T>(size, source, min_bits);
+        read_growing(val, size, count, [&val, &source](size_t first, size_t n) {
+            read_elements(val.data() + first, n, source);
+        });
     }
 }
 
-template <typename T>
-void deserialize_stl(std::list<T> &val, std::fstream &fs) {
-    int size;
-    binary::deserialize_helper(size, fs);
-    for (int i = 0; i < size; i++) {
-        T value;
-        binary::deserialize_helper(value, fs);
+template <typename T, typename Source>
+void deserialize_stl(std::list<T> &val, Source &source) {
+    size_t size = read_size(source);
+    if (format_of(source).reuse) {
+        val.resize(std::min(size, val.size()));
+        auto it = val.begin();
+        read_sequence_into<T>(size, source,
+                              [&val, &it]() -> T & { return it != val.end() ? *it++ : val.emplace_back(); },
+                              [](T &) {});
+        return;
+    }
+    val.clear();
+    read_sequence<T>(size, source, [&val](T &&value) {
         val.emplace_back(std::move(value));
+    });
+}
+
+template <typename T, size_t N, typename Source>
+void deserialize_stl(std::array<T, N> &val, Source &source) {
+    if constexpr (is_xor_float<T>::value) {
+        read_raw(val.data(), N, source);
+    } else if constexpr (is_bulk_container<std::vector<T>>::value) {
+        read_elements(val.data(), N, source);
+    } else {
+        auto it = val.begin();
+        read_sequence_into<T>(N, source, [&it]() -> T & { return *it++; }, [](T &) {});
     }
 }
 
-template <typename... Args>
-void deserialize_stl(std::tuple<Args...> &val, std::fstream &fs) {
-    deserialize_tuple(val, fs);
+template <typename... Args, typename Source>
+void deserialize_stl(std::tuple<Args...> &val, Source &source) {
+    deserialize_tuple(val, source);
 }
 
 template <typename Tuple, size_t N>
 struct deserialize_tuple_helper {
-    static void deserialize_tuple(Tuple &tuple, std::fstream &fs) {
-        binary::deserialize_helper(std::get<N>(tuple), fs);
+    template <typename Source>
+    static void deserialize_tuple(Tuple &tuple, Source &source) {
+        binary::deserialize_helper(std::get<N>(tuple), source);
     }
 };
 
 
-template <int... Index, typename... Args>
-void deserialize_tuple_helper_func(tuple_helper::IndexTuple<Index...>, std::tuple<Args...> &tuple, std::fstream &fs) {
+template <int... Index, typename... Args, typename Source>
+void deserialize_tuple_helper_func(tuple_helper::IndexTuple<Index...>, std::tuple<Args...> &tuple, Source &source) {
     // 函数实参计算顺序从左至右
-    // return std::make_tuple(deserialize_tuple_helper<std::tuple<Args...>, Index>::deserialize_tuple(tuple, fs)...);
-    int a[] = {(deserialize_tuple_helper<std::tuple<Args...>, Index>::deserialize_tuple(tuple, fs), 0)...};
+    // return std::make_tuple(deserialize_tuple_helper<std::tuple<Args...>, Index>::deserialize_tuple(tuple, source)...);
+    int a[] = {(deserialize_tuple_helper<std::tuple<Args...>, Index>::deserialize_tuple(tuple, source), 0)...};
+    (void)a;
 }
 
-template <typename... Args>
-void deserialize_tuple(std::tuple<Args...> &tuple, std::fstream &fs) {
+template <typename... Args, typename Source>
+void deserialize_tuple(std::tuple<Args...> &tuple, Source &source) {
     using tuple_index = typename tuple_helper::MakeIndex<std::tuple_size_v<std::tuple<Args...>>>::tuple_index;
-    deserialize_tuple_helper_func(tuple_index(), tuple, fs);
+    deserialize_tuple_helper_func(tuple_index(), tuple, source);
 }
 
-template <typename T>
-void deserialize_stl(std::unique_ptr<T> &val, std::fstream &fs) {
+template <typename T, typename Source>
+void deserialize_stl(std::unique_ptr<T> &val, Source &source) {
+    uint8_t present;
+    read_value(present, source);
+    if (present > 1) {
+        throw std::invalid_argument("binary: corrupt std::unique_ptr");
+    }
+    if (!present) {
+        val.reset();
+        return;
+    }
+    if (format_of(source).reuse && val) {
+        binary::deserialize_helper(*val, source);
+        return;
+    }
     T value;
-    binary::deserialize_helper(value, fs);
+    binary::deserialize_helper(value, source);
     val = std::make_unique<T>(std::move(value));
 }
 
-template <typename T>
-void deserialize_stl(std::shared_ptr<T> &val, std::fstream &fs) {
-    T value;
-    binary::deserialize_helper(value, fs);
-    val = std::make_shared<T>(std::move(value));
+template <typename T, typename Source>
+void deserialize_stl(std::shared_ptr<T> &val, Source &source) {
+    size_t tag = read_size(source);
+    if (tag == 0) {
+        val.reset();
+        return;
+    }
+    if (tag >= 2) {
+        val = std::static_pointer_cast<T>(source.find_shared(tag - 2, binary::type_id<std::remove_cv_t<T>>::get()));
+        return;
+    }
+    // the object is a member of the graph before it is read, a cycle back to it finds it
+    auto object = std::make_shared<T>();
+    source.add_shared(object, binary::type_id<std::remove_cv_t<T>>::get());
+    binary::deserialize_helper(*object, source);
+    val = std::move(object);
+}
+
+template <typename T, typename Source>
+void deserialize_stl(std::weak_ptr<T> &val, Source &source) {
+    std::shared_ptr<T> object;
+    deserialize_stl(object, source);
+    val = object;
 }
 
 } // namespace detail
@@ -0,0 +1,165 @@
+/**
+ * checksum.h - the CRC32C (Castagnoli) checksums of the binary format, computed with the crc32
+ * instructions of SSE4.2 when the CPU has them and with a table otherwise
+ */
+
+#ifndef __CHECKSUM_H_
+#define __CHECKSUM_H_
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CHECKSUM_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace checksum {
+
+// the reflected polynomial of CRC32C
+constexpr uint32_t crc32c_polynomial = 0x82f63b78;
+
+struct crc32c_tables {
+    uint32_t table[8][256];
+
+    constexpr crc32c_tables() : table() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int b = 0; b < 8; b++) {
+                crc = crc & 1 ? (crc >> 1) ^ crc32c_polynomial : crc >> 1;
+            }
+            table[0][i] = crc;
+        }
+        // table[k] advances a byte through k more zero bytes, for 8 bytes per step
+        for (uint32_t i = 0; i < 256; i++) {
+            for (int k = 1; k < 8; k++) {
+                table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xff];
+            }
+        }
+    }
+};
+
+inline constexpr crc32c_tables crc32c_table{};
+
+inline uint32_t crc32c_scalar(uint32_t crc, const char *data, size_t n) {
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(data);
+    // the tables take the bytes of a word in little-endian order, other hosts go byte by byte
+    for (; std::endian::native == std::endian::little && n >= 8; n -= 8, p += 8) {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        word ^= crc;
+        const auto &t = crc32c_table.table;
+        crc = t[7][word & 0xff] ^ t[6][(word >> 8) & 0xff] ^ t[5][(word >> 16) & 0xff] ^ t[4][(word >> 24) & 0xff] ^
+              t[3][(word >> 32) & 0xff] ^ t[2][(word >> 40) & 0xff] ^ t[1][(word >> 48) & 0xff] ^ t[0][word >> 56];
+    }
+    for (; n > 0; n--, p++) {
+        crc = (crc >> 8) ^ crc32c_table.table[0][(crc ^ *p) & 0xff];
+    }
+    return crc;
+}
+
+/**
+ * crc32c_multiply - the product of the polynomials a and b modulo the CRC32C polynomial, both
+ * bit-reflected like the checksums
+ */
+constexpr uint32_t crc32c_multiply(uint32_t a, uint32_t b) {
+    uint32_t product = 0;
+    for (uint32_t m = 1u << 31; m != 0; m >>= 1) {
+        if (a & m) {
+            product ^= b;
+        }
+        b = b & 1 ? (b >> 1) ^ crc32c_polynomial : b >> 1;
+    }
+    return product;
+}
+
+/**
+ * crc32c_shift - x to the power of 8 * n modulo the CRC32C polynomial, which multiplied with the
+ * checksum of some bytes gives the checksum of the same bytes followed by n zero bytes
+ */
+constexpr uint32_t crc32c_shift(size_t n) {
+    uint32_t p = 1u << 31;
+    for (size_t i = 0; i < 8 * n; i++) {
+        p = p & 1 ? (p >> 1) ^ crc32c_polynomial : p >> 1;
+    }
+    return p;
+}
+
+#ifdef CHECKSUM_X86_KERNELS
+/*
+ * the crc32 instruction has a latency of 3 cycles and a throughput of 1, so long inputs are
+ * cut into 3 lanes checksummed side by side and combined with crc32c_shift
+ */
+constexpr size_t crc32c_lane = 2048;
+inline constexpr uint32_t crc32c_lane_shift = crc32c_shift(crc32c_lane);
+
+__attribute__((target("sse4.2")))
+inline uint32_t crc32c_sse42(uint32_t crc, const char *data, size_t n) {
+#ifdef __x86_64__
+    uint64_t crc64 = crc;
+    for (; n >= 3 * crc32c_lane; n -= 3 * crc32c_lane, data += 3 * crc32c_lane) {
+        uint64_t crc1 = 0, crc2 = 0;
+        for (size_t i = 0; i < crc32c_lane; i += 8) {
+            uint64_t word0, word1, word2;
+            std::memcpy(&word0, data + i, sizeof(word0));
+            std::memcpy(&word1, data + crc32c_lane + i, sizeof(word1));
+            std::memcpy(&word2, data + 2 * crc32c_lane + i, sizeof(word2));
+            crc64 = _mm_crc32_u64(crc64, word0);
+            crc1 = _mm_crc32_u64(crc1, word1);
+            crc2 = _mm_crc32_u64(crc2, word2);
+        }
+        uint32_t crc01 = crc32c_multiply(crc32c_lane_shift, static_cast<uint32_t>(crc64)) ^ static_cast<uint32_t>(crc1);
+        crc64 = crc32c_multiply(crc32c_lane_shift, crc01) ^ static_cast<uint32_t>(crc2);
+    }
+    for (; n >= 8; n -= 8, data += 8) {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = static_cast<uint32_t>(crc64);
+#endif
+    for (; n >= 4; n -= 4, data += 4) {
+        uint32_t word;
+        std::memcpy(&word, data, sizeof(word));
+        crc = _mm_crc32_u32(crc, word);
+    }
+    for (; n > 0; n--, data++) {
+        crc = _mm_crc32_u8(crc, static_cast<uint8_t>(*data));
+    }
+    return crc;
+}
+#endif
+
+using crc32c_kernel = uint32_t (*)(uint32_t, const char *, size_t);
+
+/**
+ * crc32c_select - the fastest kernel the CPU supports
+ */
+inline crc32c_kernel crc32c_select() {
+#ifdef CHECKSUM_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        return crc32c_sse42;
+    }
+#endif
+    return crc32c_scalar;
+}
+
+/**
+ * crc32c - extend the checksum crc of the bytes before data with the n bytes of data, the
+ * checksum of no bytes is 0
+ */
+inline uint32_t crc32c(uint32_t crc, const char *data, size_t n) {
+    static const crc32c_kernel kernel = crc32c_select();
+    return ~kernel(~crc, data, n);
+}
+
+inline uint32_t crc32c(const char *data, size_t n) {
+    return crc32c(0, data, n);
+}
+
+} // namespace checksum
+
+#endif
\ No newline at end of file
@@ -0,0 +1,779 @@
+/**
+ * codec.h - the integer codecs of the compact binary format, the XOR codec of floating-point
+ * numbers, and the byte swapping of the fixed formats in the other byte order than the host
+ */
+
+#ifndef __CODEC_H_
+#define __CODEC_H_
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CODEC_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace codec {
+
+// the most bytes a 64-bit varint takes
+constexpr size_t max_varint_size = 10;
+
+/**
+ * zigzag_encode - map signed integers to unsigned ones so that small magnitudes stay small:
+ * 0, -1, 1, -2, ... become 0, 1, 2, 3, ...
+ */
+inline uint64_t zigzag_encode(int64_t val) {
+    return (static_cast<uint64_t>(val) << 1) ^ static_cast<uint64_t>(val >> 63);
+}
+
+inline int64_t zigzag_decode(uint64_t val) {
+    return static_cast<int64_t>((val >> 1) ^ (~(val & 1) + 1));
+}
+
+/**
+ * encode_varint - write val as LEB128, 7 bits per byte with the high bit set on all but the
+ * last byte, and return the number of bytes written to out
+ */
+inline size_t encode_varint(uint64_t val, char *out) {
+    size_t n = 0;
+    while (val >= 0x80) {
+        out[n++] = static_cast<char>(val | 0x80);
+        val >>= 7;
+    }
+    out[n++] = static_cast<char>(val);
+    return n;
+}
+
+/**
+ * varint_size - the number of bytes encode_varint writes for val
+ */
+constexpr size_t varint_size(uint64_t val) {
+    return (std::bit_width(val | 1) + 6) / 7;
+}
+
+/*
+ * stream VByte: the integers are split in groups of 4, every group has a control byte holding
+ * 2 bits per integer for its length, and the bytes of the integers follow in a separate data
+ * area. The data length is known from the control bytes alone, so a whole block can be read at
+ * once and decoded with a byte shuffle per group. 32-bit integers take 1, 2, 3 or 4 bytes and
+ * 64-bit ones 1, 2, 4 or 8 bytes, always in little-endian order
+ */
+
+// the bytes the decoders may read past the data area and the values they may write past n
+constexpr size_t svb_padding = 32;
+
+constexpr size_t svb_control_size(size_t n) {
+    return (n + 3) / 4;
+}
+
+struct svb_tables {
+    uint8_t shuffle[256][16];
+    uint8_t length[256];
+
+    constexpr svb_tables() : shuffle(), length() {
+        for (int c = 0; c < 256; c++) {
+            int pos = 0;
+            for (int i = 0; i < 4; i++) {
+                int len = ((c >> (2 * i)) & 3) + 1;
+                for (int b = 0; b < 4; b++) {
+                    shuffle[c][4 * i + b] = b < len ? pos + b : 0xff;
+                }
+                pos += len;
+            }
+            length[c] = pos;
+        }
+    }
+};
+
+inline constexpr svb_tables svb_table{};
+
+/**
+ * svb_encode32 - encode the n values of in, and return the number of data bytes
+ */
+inline size_t svb_encode32(const uint32_t *in, size_t n, uint8_t *control, uint8_t *data) {
+    uint8_t *start = data;
+    for (size_t g = 0; g < svb_control_size(n); g++) {
+        uint8_t c = 0;
+        for (size_t i = 0; i < 4 && 4 * g + i < n; i++) {
+            uint32_t val = in[4 * g + i];
+            int code = (val > 0xff) + (val > 0xffff) + (val > 0xffffff);
+            for (int b = 0; b <= code; b++) {
+                *data++ = static_cast<uint8_t>(val >> (8 * b));
+            }
+            c |= code << (2 * i);
+        }
+        control[g] = c;
+    }
+    return data - start;
+}
+
+/**
+ * svb_data_size32 - the number of data bytes of n encoded values
+ */
+inline size_t svb_data_size32(const uint8_t *control, size_t n) {
+    size_t size = 0;
+    for (size_t g = 0; g < svb_control_size(n); g++) {
+        size += svb_table.length[control[g]];
+    }
+    // the unused codes of the last group are 0, which is counted as a byte each
+    return size - (svb_control_size(n) * 4 - n);
+}
+
+inline void svb_decode32_scalar(const uint8_t *control, const uint8_t *data, size_t n, uint32_t *out) {
+    for (size_t g = 0; g < svb_control_size(n); g++) {
+        uint8_t c = control[g];
+        for (size_t i = 0; i < 4; i++) {
+            int len = ((c >> (2 * i)) & 3) + 1;
+            uint32_t val = 0;
+            for (int b = 0; b < len; b++) {
+                val |= static_cast<uint32_t>(data[b]) << (8 * b);
+            }
+            out[4 * g + i] = val;
+            data += len;
+        }
+    }
+}
+
+#ifdef CODEC_X86_KERNELS
+__attribute__((target("ssse3")))
+inline void svb_decode32_ssse3(const uint8_t *control, const uint8_t *data, size_t n, uint32_t *out) {
+    for (size_t g = 0; g < svb_control_size(n); g++) {
+        uint8_t c = control[g];
+        __m128i val = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+        __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i *>(svb_table.shuffle[c]));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 4 * g), _mm_shuffle_epi8(val, shuffle));
+        data += svb_table.length[c];
+    }
+}
+
+// two groups per step, one in each 128-bit lane
+__attribute__((target("avx2")))
+inline void svb_decode32_avx2(const uint8_t *control, const uint8_t *data, size_t n, uint32_t *out) {
+    size_t groups = svb_control_size(n);
+    size_t g = 0;
+    for (; g + 1 < groups; g += 2) {
+        uint8_t c0 = control[g], c1 = control[g + 1];
+        const uint8_t *next = data + svb_table.length[c0];
+        __m256i val = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(next)), 1);
+        __m256i shuffle = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(svb_table.shuffle[c0]))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(svb_table.shuffle[c1])), 1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 4 * g), _mm256_shuffle_epi8(val, shuffle));
+        data = next + svb_table.length[c1];
+    }
+    if (g < groups) {
+        uint8_t c = control[g];
+        __m128i val = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+        __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i *>(svb_table.shuffle[c]));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 4 * g), _mm_shuffle_epi8(val, shuffle));
+    }
+}
+#endif
+
+using svb_decode32_kernel = void (*)(const uint8_t *, const uint8_t *, size_t, uint32_t *);
+
+/**
+ * svb_select_decode32 - the fastest decoder the CPU supports
+ */
+inline svb_decode32_kernel svb_select_decode32() {
+#ifdef CODEC_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return svb_decode32_avx2;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return svb_decode32_ssse3;
+    }
+#endif
+    return svb_decode32_scalar;
+}
+
+/**
+ * svb_decode32 - decode n values into out, data must be followed by svb_padding readable bytes
+ * and out must have room for n + svb_padding values
+ */
+inline void svb_decode32(const uint8_t *control, const uint8_t *data, size_t n, uint32_t *out) {
+    static const svb_decode32_kernel kernel = svb_select_decode32();
+    kernel(control, data, n, out);
+}
+
+inline int svb_length64(int code) {
+    return 1 << code;
+}
+
+/**
+ * svb_encode64 - encode the n values of in, and return the number of data bytes
+ */
+inline size_t svb_encode64(const uint64_t *in, size_t n, uint8_t *control, uint8_t *data) {
+    uint8_t *start = data;
+    for (size_t g = 0; g < svb_control_size(n); g++) {
+        uint8_t c = 0;
+        for (size_t i = 0; i < 4 && 4 * g + i < n; i++) {
+            uint64_t val = in[4 * g + i];
+            int code = val <= 0xff ? 0 : val <= 0xffff ? 1 : val <= 0xffffffffu ? 2 : 3;
+            for (int b = 0; b < svb_length64(code); b++) {
+                *data++ = static_cast<uint8_t>(val >> (8 * b));
+            }
+            c |= code << (2 * i);
+        }
+        control[g] = c;
+    }
+    return data - start;
+}
+
+inline size_t svb_data_size64(const uint8_t *control, size_t n) {
+    size_t size = 0;
+    for (size_t i = 0; i < n; i++) {
+        size += svb_length64((control[i / 4] >> (2 * (i % 4))) & 3);
+    }
+    return size;
+}
+
+inline void svb_decode64_scalar(const uint8_t *control, const uint8_t *data, size_t n, uint64_t *out) {
+    for (size_t i = 0; i < n; i++) {
+        int len = svb_length64((control[i / 4] >> (2 * (i % 4))) & 3);
+        uint64_t val = 0;
+        for (int b = 0; b < len; b++) {
+            val |= static_cast<uint64_t>(data[b]) << (8 * b);
+        }
+        out[i] = val;
+        data += len;
+    }
+}
+
+// a 64-bit group takes up to 32 bytes, so its two halves are shuffled apart, each picked by the
+// 4 bits of the lengths of its 2 integers
+struct svb_tables64 {
+    uint8_t shuffle[16][16];
+    uint8_t length[16];
+
+    constexpr svb_tables64() : shuffle(), length() {
+        for (int c = 0; c < 16; c++) {
+            int pos = 0;
+            for (int i = 0; i < 2; i++) {
+                int len = 1 << ((c >> (2 * i)) & 3);
+                for (int b = 0; b < 8; b++) {
+                    shuffle[c][8 * i + b] = b < len ? pos + b : 0xff;
+                }
+                pos += len;
+            }
+            length[c] = pos;
+        }
+    }
+};
+
+inline constexpr svb_tables64 svb_table64{};
+
+#ifdef CODEC_X86_KERNELS
+__attribute__((target("ssse3")))
+inline void svb_decode64_ssse3(const uint8_t *control, const uint8_t *data, size_t n, uint64_t *out) {
+    for (size_t g = 0; g < svb_control_size(n); g++) {
+        uint8_t c0 = control[g] & 15, c1 = control[g] >> 4;
+        const uint8_t *next = data + svb_table64.length[c0];
+        __m128i val0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+        __m128i val1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(next));
+        __m128i shuffle0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(svb_table64.shuffle[c0]));
+        __m128i shuffle1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(svb_table64.shuffle[c1]));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 4 * g), _mm_shuffle_epi8(val0, shuffle0));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 4 * g + 2), _mm_shuffle_epi8(val1, shuffle1));
+        data = next + svb_table64.length[c1];
+    }
+}
+
+// a group per step, its two halves in the two 128-bit lanes
+__attribute__((target("avx2")))
+inline void svb_decode64_avx2(const uint8_t *control, const uint8_t *data, size_t n, uint64_t *out) {
+    for (size_t g = 0; g < svb_control_size(n); g++) {
+        uint8_t c0 = control[g] & 15, c1 = control[g] >> 4;
+        const uint8_t *next = data + svb_table64.length[c0];
+        __m256i val = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(next)), 1);
+        __m256i shuffle = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(svb_table64.shuffle[c0]))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(svb_table64.shuffle[c1])), 1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 4 * g), _mm256_shuffle_epi8(val, shuffle));
+        data = next + svb_table64.length[c1];
+    }
+}
+#endif
+
+using svb_decode64_kernel = void (*)(const uint8_t *, const uint8_t *, size_t, uint64_t *);
+
+/**
+ * svb_select_decode64 - the fastest decoder the CPU supports
+ */
+inline svb_decode64_kernel svb_select_decode64() {
+#ifdef CODEC_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return svb_decode64_avx2;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return svb_decode64_ssse3;
+    }
+#endif
+    return svb_decode64_scalar;
+}
+
+/**
+ * svb_decode64 - decode n values into out, with the padding of svb_decode32
+ */
+inline void svb_decode64(const uint8_t *control, const uint8_t *data, size_t n, uint64_t *out) {
+    static const svb_decode64_kernel kernel = svb_select_decode64();
+    kernel(control, data, n, out);
+}
+
+/*
+ * byte swapping: a fixed format in the other byte order than the host's stores every number with
+ * its bytes reversed. The kernels reverse the bytes of n elements of Size bytes each from in to
+ * out, which may be the same buffer
+ */
+
+template <size_t Size>
+struct byte_swap_mask {
+    uint8_t bytes[32];
+
+    // the same shuffle in both 128-bit lanes, which hold whole elements
+    constexpr byte_swap_mask() : bytes() {
+        for (size_t i = 0; i < 32; i++) {
+            bytes[i] = static_cast<uint8_t>((i % 16) / Size * Size + Size - 1 - (i % 16) % Size);
+        }
+    }
+};
+
+template <size_t Size>
+inline constexpr byte_swap_mask<Size> byte_swap_masks{};
+
+template <size_t Size>
+inline void byte_swap_scalar(const char *in, size_t n, char *out) {
+    for (size_t i = 0; i < n; i++) {
+        char value[Size];
+        std::memcpy(value, in + Size * i, Size);
+        for (size_t b = 0; b < Size; b++) {
+            out[Size * i + b] = value[Size - 1 - b];
+        }
+    }
+}
+
+#ifdef CODEC_X86_KERNELS
+template <size_t Size>
+__attribute__((target("ssse3")))
+inline void byte_swap_ssse3(const char *in, size_t n, char *out) {
+    const __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i *>(byte_swap_masks<Size>.bytes));
+    size_t bytes = Size * n, i = 0;
+    for (; i + 16 <= bytes; i += 16) {
+        __m128i val = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_shuffle_epi8(val, mask));
+    }
+    byte_swap_scalar<Size>(in + i, (bytes - i) / Size, out + i);
+}
+
+template <size_t Size>
+__attribute__((target("avx2")))
+inline void byte_swap_avx2(const char *in, size_t n, char *out) {
+    const __m256i mask = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(byte_swap_masks<Size>.bytes));
+    size_t bytes = Size * n, i = 0;
+    for (; i + 64 <= bytes; i += 64) {
+        __m256i val0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+        __m256i val1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i + 32));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_shuffle_epi8(val0, mask));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i + 32), _mm256_shuffle_epi8(val1, mask));
+    }
+    byte_swap_scalar<Size>(in + i, (bytes - i) / Size, out + i);
+}
+#endif
+/*
+ * bit packing: 128 32-bit values which all fit in b bits are packed into 16 * b bytes. Value i
+ * goes to lane i % 4 of 4 interleaved lanes of little-endian 32-bit words, and every lane holds
+ * its 32 values one after another from the low bits up, so 4 values are unpacked at once by the
+ * shifts of a 128-bit register
+ */
+constexpr size_t bp_frame = 128;
+
+constexpr size_t bp_size(unsigned bits) {
+    return bp_frame / 8 * bits;
+}
+
+inline uint32_t bp_load(const uint8_t *in) {
+    return static_cast<uint32_t>(in[0]) | static_cast<uint32_t>(in[1]) << 8 | static_cast<uint32_t>(in[2]) << 16 |
+           static_cast<uint32_t>(in[3]) << 24;
+}
+
+inline void bp_store(uint32_t val, uint8_t *out) {
+    for (int b = 0; b < 4; b++) {
+        out[b] = static_cast<uint8_t>(val >> (8 * b));
+    }
+}
+
+/**
+ * bp_width - the bits the widest of the 128 values of in takes
+ */
+inline unsigned bp_width(const uint32_t *in) {
+    uint32_t any = 0;
+    for (size_t i = 0; i < bp_frame; i++) {
+        any |= in[i];
+    }
+    return std::bit_width(any);
+}
+
+/**
+ * bp_pack - pack the 128 values of in, which fit in bits, into bp_size(bits) bytes of out
+ */
+inline void bp_pack(const uint32_t *in, unsigned bits, uint8_t *out) {
+    for (size_t lane = 0; bits > 0 && lane < 4; lane++) {
+        uint64_t acc = 0;
+        unsigned filled = 0;
+        uint8_t *word = out + 4 * lane;
+        for (size_t j = 0; j < bp_frame / 4; j++) {
+            acc |= static_cast<uint64_t>(in[4 * j + lane]) << filled;
+            filled += bits;
+            if (filled >= 32) {
+                bp_store(static_cast<uint32_t>(acc), word);
+                word += 16;
+                acc >>= 32;
+                filled -= 32;
+            }
+        }
+    }
+}
+
+inline void bp_unpack_scalar(const uint8_t *in, unsigned bits, uint32_t *out) {
+    uint64_t mask = (uint64_t(1) << bits) - 1;
+    for (size_t lane = 0; lane < 4; lane++) {
+        uint64_t acc = 0;
+        unsigned avail = 0;
+        const uint8_t *word = in + 4 * lane;
+        for (size_t j = 0; j < bp_frame / 4; j++) {
+            if (avail < bits) {
+                acc |= static_cast<uint64_t>(bp_load(word)) << avail;
+                word += 16;
+                avail += 32;
+            }
+            out[4 * j + lane] = static_cast<uint32_t>(acc & mask);
+            acc >>= bits;
+            avail -= bits;
+        }
+    }
+}
+
+#ifdef CODEC_X86_KERNELS
+// unrolled for every width, so the shifts are constants and the loads fall where the words end
+template <unsigned Bits>
+__attribute__((target("sse2")))
+inline void bp_unpack_sse2(const uint8_t *in, uint32_t *out) {
+    const __m128i *words = reinterpret_cast<const __m128i *>(in);
+    __m128i *values = reinterpret_cast<__m128i *>(out);
+    if constexpr (Bits == 0) {
+        for (size_t j = 0; j < bp_frame / 4; j++) {
+            _mm_storeu_si128(values + j, _mm_setzero_si128());
+        }
+    } else {
+        const __m128i mask = _mm_set1_epi32(static_cast<int>(Bits == 32 ? ~0u : (1u << Bits) - 1));
+        __m128i word = _mm_loadu_si128(words++);
+        unsigned shift = 0;
+#pragma GCC unroll 32
+        for (size_t j = 0; j < bp_frame / 4; j++) {
+            __m128i val = _mm_srli_epi32(word, shift);
+            shift += Bits;
+            if (shift >= 32 && j + 1 < bp_frame / 4) {
+                shift -= 32;
+                word = _mm_loadu_si128(words++);
+                if (shift > 0) {
+                    val = _mm_or_si128(val, _mm_slli_epi32(word, Bits - shift));
+                }
+            }
+            _mm_storeu_si128(values + j, _mm_and_si128(val, mask));
+        }
+    }
+}
+
+using bp_unpack_kernel = void (*)(const uint8_t *, uint32_t *);
+
+template <size_t... Bits>
+constexpr std::array<bp_unpack_kernel, sizeof...(Bits)> bp_sse2_kernels(std::index_sequence<Bits...>) {
+    return {bp_unpack_sse2<Bits>...};
+}
+
+inline constexpr std::array<bp_unpack_kernel, 33> bp_sse2_table = bp_sse2_kernels(std::make_index_sequence<33>());
+#endif
+
+inline bool bp_has_sse2() {
+#ifdef CODEC_X86_KERNELS
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+#else
+    return false;
+#endif
+}
+
+/**
+ * bp_unpack - unpack the 128 values of bits each packed by bp_pack into out
+ */
+inline void bp_unpack(const uint8_t *in, unsigned bits, uint32_t *out) {
+#ifdef CODEC_X86_KERNELS
+    static const bool sse2 = bp_has_sse2();
+    if (sse2) {
+        bp_sse2_table[bits](in, out);
+        return;
+    }
+#endif
+    bp_unpack_scalar(in, bits, out);
+}
+
+using byte_swap_kernel = void (*)(const char *, size_t, char *);
+
+/**
+ * byte_swap_select - the fastest byte swap of Size byte elements the CPU supports
+ */
+template <size_t Size>
+inline byte_swap_kernel byte_swap_select() {
+#ifdef CODEC_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return byte_swap_avx2<Size>;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return byte_swap_ssse3<Size>;
+    }
+#endif
+    return byte_swap_scalar<Size>;
+}
+
+/**
+ * byte_swap - reverse the bytes of the n elements of Size bytes in in, into out
+ */
+template <size_t Size>
+inline void byte_swap(const char *in, size_t n, char *out) {
+    static_assert(Size > 1 && 16 % Size == 0, "codec: only elements of 2, 4, 8 or 16 bytes are swapped");
+    static const byte_swap_kernel kernel = byte_swap_select<Size>();
+    kernel(in, n, out);
+}
+
+/**
+ * byte_swapped - val with its bytes reversed
+ */
+template <typename T>
+inline T byte_swapped(T val) {
+    if constexpr (sizeof(T) > 1) {
+        byte_swap_scalar<sizeof(T)>(reinterpret_cast<const char *>(&val), 1, reinterpret_cast<char *>(&val));
+    }
+    return val;
+}
+
+/*
+ * the XOR codec of floating-point numbers (Gorilla): the first number is written whole and every
+ * next one as its XOR with the one before, which has few significant bits when the numbers
+ * change slowly. A 0 bit stands for an equal number, 10 for an XOR whose significant bits fall
+ * in the window of the last 11, followed by the bits of that window, and 11 for a new window,
+ * followed by its leading zeros in 5 bits, its width less one and its bits. The bits are
+ * written most significant first
+ */
+template <typename T>
+using xor_word = std::conditional_t<sizeof(T) == 8, uint64_t, uint32_t>;
+
+// the bits of the width of a window
+template <typename T>
+constexpr unsigned xor_width_bits = sizeof(T) == 8 ? 6 : 5;
+
+// the bytes the decoder may read past the end of its input
+constexpr size_t xor_padding = 8;
+
+/**
+ * xor_bound - the most bytes xor_encode writes for n numbers
+ */
+template <typename T>
+constexpr size_t xor_bound(size_t n) {
+    return n == 0 ? 0 : (8 * sizeof(T) + (n - 1) * (2 + 5 + xor_width_bits<T> + 8 * sizeof(T)) + 7) / 8;
+}
+
+// the 8 bytes from p as a big-endian word
+inline uint64_t xor_load(const uint8_t *p) {
+    uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    if constexpr (std::endian::native == std::endian::little) {
+#ifdef __GNUC__
+        word = __builtin_bswap64(word);
+#else
+        word = byte_swapped(word);
+#endif
+    }
+    return word;
+}
+
+class xor_bit_writer {
+public:
+    explicit xor_bit_writer(uint8_t *out) : out_(out), start_(out), acc_(0), filled_(0) {}
+
+    // append the low bits of val, up to 32 of them
+    void put(uint64_t val, unsigned bits) {
+        acc_ = acc_ << bits | val;
+        filled_ += bits;
+        if (filled_ >= 32) {
+            filled_ -= 32;
+            store(static_cast<uint32_t>(acc_ >> filled_), 4);
+        }
+    }
+
+    void put_wide(uint64_t val, unsigned bits) {
+        if (bits > 32) {
+            put(val >> 32, bits - 32);
+            bits = 32;
+        }
+        put(val & 0xffffffffu, bits);
+    }
+
+    // flush the last bits padded with zeros, and return the number of bytes written
+    size_t finish() {
+        if (filled_ > 0) {
+            store(static_cast<uint32_t>(acc_ << (32 - filled_)), (filled_ + 7) / 8);
+            filled_ = 0;
+        }
+        return out_ - start_;
+    }
+
+private:
+    void store(uint32_t word, size_t n) {
+        for (size_t b = 0; b < n; b++) {
+            out_[b] = static_cast<uint8_t>(word >> (24 - 8 * b));
+        }
+        out_ += n;
+    }
+
+    uint8_t *out_;
+    uint8_t *start_;
+    uint64_t acc_;
+    unsigned filled_;
+};
+
+class xor_bit_reader {
+public:
+    explicit xor_bit_reader(const uint8_t *in) : in_(in), pos_(0) {}
+
+    // the next bits in the high bits, 57 of them at least
+    uint64_t peek() const {
+        return xor_load(in_ + (pos_ >> 3)) << (pos_ & 7);
+    }
+
+    void skip(unsigned bits) {
+        pos_ += bits;
+    }
+
+    // the next bits, up to 57 of them
+    uint64_t get(unsigned bits) {
+        uint64_t word = peek();
+        pos_ += bits;
+        return bits == 0 ? 0 : word >> (64 - bits);
+    }
+
+    uint64_t get_wide(unsigned bits) {
+        if (bits > 57) {
+            uint64_t high = get(bits - 32);
+            return high << 32 | get(32);
+        }
+        return get(bits);
+    }
+
+    // the number of bytes read
+    size_t size() const {
+        return (pos_ + 7) / 8;
+    }
+
+private:
+    const uint8_t *in_;
+    size_t pos_;
+};
+
+/**
+ * xor_encode - encode the n numbers of in, and return the number of bytes written to out
+ */
+template <typename T>
+size_t xor_encode(const T *in, size_t n, uint8_t *out) {
+    using word = xor_word<T>;
+    constexpr unsigned width = 8 * sizeof(T);
+    xor_bit_writer bits(out);
+    if (n == 0) {
+        return 0;
+    }
+    word prev = std::bit_cast<word>(in[0]);
+    bits.put_wide(prev, width);
+    // no XOR has width leading zeros, so the first one opens a window
+    unsigned lead = width, trail = 0;
+    for (size_t i = 1; i < n; i++) {
+        word cur = std::bit_cast<word>(in[i]);
+        word x = cur ^ prev;
+        prev = cur;
+        if (x == 0) {
+            bits.put(0, 1);
+            continue;
+        }
+        unsigned l = std::min(static_cast<unsigned>(std::countl_zero(x)), 31u);
+        unsigned t = std::countr_zero(x);
+        if (l >= lead && t >= trail) {
+            bits.put(2, 2);
+            bits.put_wide(x >> trail, width - lead - trail);
+            continue;
+        }
+        lead = l;
+        trail = t;
+        bits.put(3, 2);
+        bits.put(lead, 5);
+        bits.put(width - lead - trail - 1, xor_width_bits<T>);
+        bits.put_wide(x >> trail, width - lead - trail);
+    }
+    return bits.finish();
+}
+
+/**
+ * xor_decode - decode n numbers written by xor_encode into out, and return the number of bytes
+ * read from in, which must be readable for xor_padding bytes past them. A window wider than the
+ * numbers reads as ~size_t(0)
+ */
+template <typename T>
+size_t xor_decode(const uint8_t *in, size_t n, T *out) {
+    using word = xor_word<T>;
+    constexpr unsigned width = 8 * sizeof(T);
+    xor_bit_reader bits(in);
+    if (n == 0) {
+        return 0;
+    }
+    word prev = static_cast<word>(bits.get_wide(width));
+    out[0] = std::bit_cast<T>(prev);
+    unsigned lead = 0, trail = 0;
+    for (size_t i = 1; i < n; i++) {
+        // the control bits and a new window fit in one peek
+        uint64_t head = bits.peek();
+        if (head >> 63 == 0) {
+            bits.skip(1);
+            out[i] = std::bit_cast<T>(prev);
+            continue;
+        }
+        if (head >> 62 & 1) {
+            constexpr unsigned len_shift = 64 - 2 - 5 - xor_width_bits<T>;
+            lead = static_cast<unsigned>(head >> (64 - 2 - 5) & 31);
+            unsigned len = static_cast<unsigned>(head >> len_shift & ((1u << xor_width_bits<T>) - 1)) + 1;
+            if (lead + len > width) {
+                return ~size_t(0);
+            }
+            trail = width - lead - len;
+            bits.skip(2 + 5 + xor_width_bits<T>);
+        } else {
+            bits.skip(2);
+        }
+        prev ^= static_cast<word>(bits.get_wide(width - lead - trail) << trail);
+        out[i] = std::bit_cast<T>(prev);
+    }
+    return bits.size();
+}
+
+} // namespace codec
+
+#endif
\ No newline at end of file
@@ -0,0 +1,779 @@
+/**
+ * compress.h - the block stage of binary serialization. The serialized bytes are cut into blocks
+ * of a fixed size, and every block is compressed on its own with a small LZ codec and optionally
+ * checksummed, so a stream is decompressed and verified block by block while it is read
+ */
+
+#ifndef __COMPRESS_H_
+#define __COMPRESS_H_
+
+#include <algorithm>
+#include <bit>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "checksum.h"
+
+namespace compress {
+
+/*
+ * the LZ codec: a block is a list of sequences, each one a token byte holding the number of
+ * literals in its high 4 bits and the match length minus 4 in its low 4 bits, the extra bytes
+ * of a length of 15 or more (255 each until the last), the literals, and the match as a 2-byte
+ * offset back into the output followed by the extra bytes of its length. The last sequence
+ * has only literals, and at least the last 5 bytes of a block are literals
+ */
+
+constexpr size_t lz_min_match = 4;
+constexpr size_t lz_last_literals = 5;
+constexpr size_t lz_max_offset = 65535;
+constexpr int lz_hash_bits = 14;
+
+/**
+ * lz_bound - the most bytes lz_compress writes for n bytes
+ */
+constexpr size_t lz_bound(size_t n) {
+    return n + n / 255 + 16;
+}
+
+inline uint32_t lz_load32(const char *p) {
+    uint32_t val;
+    std::memcpy(&val, p, sizeof(val));
+    return val;
+}
+
+inline uint32_t lz_hash(uint32_t seq) {
+    return (seq * 2654435761u) >> (32 - lz_hash_bits);
+}
+
+inline char *lz_write_length(size_t len, char *out) {
+    for (; len >= 255; len -= 255) {
+        *out++ = static_cast<char>(255);
+    }
+    *out++ = static_cast<char>(len);
+    return out;
+}
+
+inline char *lz_write_sequence(const char *literals, size_t lit_len, size_t offset, size_t match_len, char *out) {
+    char *token = out++;
+    size_t match_code = match_len == 0 ? 0 : match_len - lz_min_match;
+    *token = static_cast<char>((lit_len < 15 ? lit_len : 15) << 4 | (match_code < 15 ? match_code : 15));
+    if (lit_len >= 15) {
+        out = lz_write_length(lit_len - 15, out);
+    }
+    std::memcpy(out, literals, lit_len);
+    out += lit_len;
+    if (match_len != 0) {
+        *out++ = static_cast<char>(offset);
+        *out++ = static_cast<char>(offset >> 8);
+        if (match_code >= 15) {
+            out = lz_write_length(match_code - 15, out);
+        }
+    }
+    return out;
+}
+
+/**
+ * lz_compress - compress the n bytes of in into out, which has room for lz_bound(n) bytes, and
+ * return the number of bytes written
+ */
+inline size_t lz_compress(const char *in, size_t n, char *out) {
+    char *start = out;
+    size_t anchor = 0;
+    if (n > lz_last_literals + 2 * lz_min_match) {
+        std::vector<uint32_t> table(1 << lz_hash_bits);
+        size_t limit = n - lz_last_literals - lz_min_match;
+        size_t ip = 0;
+        while (ip < limit) {
+            uint32_t seq = lz_load32(in + ip);
+            uint32_t h = lz_hash(seq);
+            size_t ref = table[h];
+            table[h] = static_cast<uint32_t>(ip);
+            if (ref >= ip || ip - ref > lz_max_offset || lz_load32(in + ref) != seq) {
+                // skip faster through data which does not compress
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+            size_t len = lz_min_match;
+            while (ip + len < n - lz_last_literals && in[ref + len] == in[ip + len]) {
+                len++;
+            }
+            out = lz_write_sequence(in + anchor, ip - anchor, ip - ref, len, out);
+            ip += len;
+            anchor = ip;
+            if (ip < limit) {
+                table[lz_hash(lz_load32(in + ip - 2))] = static_cast<uint32_t>(ip - 2);
+            }
+        }
+    }
+    out = lz_write_sequence(in + anchor, n - anchor, 0, 0, out);
+    return out - start;
+}
+
+inline size_t lz_read_length(const char *&in, const char *end) {
+    size_t len = 0;
+    unsigned char byte;
+    do {
+        if (in == end) {
+            throw std::invalid_argument("compress: the block is corrupt");
+        }
+        byte = static_cast<unsigned char>(*in++);
+        len += byte;
+    } while (byte == 255);
+    return len;
+}
+
+/**
+ * lz_decompress - decompress the n bytes of in into out, which must decompress to exactly
+ * out_size bytes, throw std::invalid_argument when the block is corrupt
+ */
+inline void lz_decompress(const char *in, size_t n, char *out, size_t out_size) {
+    const char *end = in + n;
+    size_t op = 0;
+    for (;;) {
+        if (in == end) {
+            throw std::invalid_argument("compress: the block is corrupt");
+        }
+        unsigned char token = static_cast<unsigned char>(*in++);
+        size_t lit_len = token >> 4;
+        if (lit_len == 15) {
+            lit_len += lz_read_length(in, end);
+        }
+        if (lit_len > static_cast<size_t>(end - in) || lit_len > out_size - op) {
+            throw std::invalid_argument("compress: the block is corrupt");
+        }
+        std::memcpy(out + op, in, lit_len);
+        in += lit_len;
+        op += lit_len;
+        if (op == out_size && in == end) {
+            return;
+        }
+        if (end - in < 2) {
+            throw std::invalid_argument("compress: the block is corrupt");
+        }
+        size_t offset = static_cast<unsigned char>(in[0]) | static_cast<size_t>(static_cast<unsigned char>(in[1])) << 8;
+        in += 2;
+        size_t match_len = (token & 15) + lz_min_match;
+        if ((token & 15) == 15) {
+            match_len += lz_read_length(in, end);
+        }
+        if (offset == 0 || offset > op || match_len > out_size - op) {
+            throw std::invalid_argument("compress: the block is corrupt");
+        }
+        const char *match = out + op - offset;
+        if (offset >= match_len) {
+            std::memcpy(out + op, match, match_len);
+        } else {
+            // the match overlaps the bytes it produces, like a run of one repeated byte
+            for (size_t i = 0; i < match_len; i++) {
+                out[op + i] = match[i];
+            }
+        }
+        op += match_len;
+    }
+}
+
+/*
+ * a compressed stream is a list of blocks, each one a header of the uncompressed and the stored
+ * size as 4 bytes each, followed by the stored bytes. A block which does not get smaller is
+ * stored as it is, with both sizes equal, and a header with an uncompressed size of 0 ends the
+ * stream
+ */
+
+constexpr size_t default_block_size = 1 << 16;
+// the largest block a reader accepts, so a corrupt header cannot make it allocate a huge buffer
+constexpr size_t max_block_size = 1 << 24;
+
+struct block_header {
+    uint32_t raw_size;
+    uint32_t stored_size;
+};
+
+/*
+ * the headers and the checksums are stored little-endian on any host, so the framing of the
+ * blocks does not depend on the byte order of the serialized numbers
+ */
+inline uint32_t little_endian(uint32_t val) {
+    if constexpr (std::endian::native == std::endian::big) {
+        return __builtin_bswap32(val);
+    }
+    return val;
+}
+
+inline block_header little_endian(const block_header &header) {
+    return block_header{little_endian(header.raw_size), little_endian(header.stored_size)};
+}
+
+/**
+ * block_options - how the blocks are stored, a stream must be read with the options it was
+ * written with except for threads
+ */
+struct block_options {
+    // the blocks are compressed with the LZ codec, or stored as they are
+    bool compress = true;
+    // every block, and the end of the stream, is followed by the CRC32C of its header and its
+    // stored bytes, which is checked before the block is used
+    bool checksum = false;
+    // the number of threads compressing or decompressing the blocks
+    unsigned threads = 1;
+    size_t block_size = default_block_size;
+};
+
+/**
+ * pack_block - compress raw into packed and return the header of the block, a block which does
+ * not get smaller, or is not to be compressed, is stored from raw as it is
+ */
+inline block_header pack_block(const char *raw, size_t n, std::vector<char> &packed, bool compress) {
+    block_header header;
+    header.raw_size = static_cast<uint32_t>(n);
+    header.stored_size = header.raw_size;
+    if (compress) {
+        if (packed.size() < lz_bound(n)) {
+            packed.resize(lz_bound(n));
+        }
+        size_t size = lz_compress(raw, n, packed.data());
+        header.stored_size = static_cast<uint32_t>(size < n ? size : n);
+    }
+    return header;
+}
+
+inline const char *stored_bytes(const block_header &header, const char *raw, const std::vector<char> &packed) {
+    return header.stored_size == header.raw_size ? raw : packed.data();
+}
+
+/**
+ * block_checksum - the CRC32C of the header and the stored bytes of a block
+ */
+inline uint32_t block_checksum(const block_header &header, const char *stored) {
+    block_header stored_header = little_endian(header);
+    uint32_t crc = checksum::crc32c(reinterpret_cast<const char *>(&stored_header), sizeof(stored_header));
+    return checksum::crc32c(crc, stored, header.stored_size);
+}
+
+inline void check_block(const block_header &header, const char *stored, uint32_t crc) {
+    if (block_checksum(header, stored) != crc) {
+        throw std::invalid_argument("compress::block_source: the checksum of a block does not match");
+    }
+}
+
+// the block is read in full before anything is allocated for it
+inline void check_header(const block_header &header) {
+    if (header.raw_size > max_block_size || header.stored_size > header.raw_size) {
+        throw std::invalid_argument("compress::block_source: the block header is corrupt");
+    }
+}
+
+/**
+ * unpack_block - decompress the stored bytes of a block into raw
+ */
+inline void unpack_block(const block_header &header, const std::vector<char> &stored, std::vector<char> &raw) {
+    raw.resize(header.raw_size);
+    if (header.stored_size == header.raw_size) {
+        std::memcpy(raw.data(), stored.data(), header.raw_size);
+    } else {
+        lz_decompress(stored.data(), header.stored_size, raw.data(), raw.size());
+    }
+}
+
+/*
+ * with more than one thread the blocks move through a ring of twice as many slots as there are
+ * threads, which bounds the blocks in flight. A slot is free, then filled with the bytes of a
+ * block, then done once the block is compressed or decompressed
+ */
+enum class slot_state { free, filled, done, failed };
+
+struct block_slot {
+    std::vector<char> raw;
+    std::vector<char> packed;
+    block_header header;
+    uint32_t crc;
+    slot_state state = slot_state::free;
+    std::exception_ptr error;
+};
+
+/**
+ * block_sink - store the serialized bytes block by block into sink. The bytes of a partial
+ * block are written by flush(), and finish() or the destructor ends the stream. With more than
+ * one thread, the blocks are compressed by that many worker threads and written to sink by one
+ * more, while the caller keeps encoding the next ones. The first exception of those threads is
+ * thrown to the caller by the next write, flush() or finish()
+ */
+template <typename Sink>
+class block_sink {
+public:
+    explicit block_sink(Sink &sink, const block_options &opts = block_options())
+        : sink_(sink), opts_(opts), finished_(false), fill_(0) {
+        if (opts.block_size == 0 || opts.block_size > max_block_size) {
+            throw std::invalid_argument("compress::block_sink: the block size is out of range");
+        }
+        buf_.resize(opts.block_size);
+        if (opts.threads > 1) {
+            start(opts.threads);
+        }
+    }
+
+    block_sink(const block_sink &) = delete;
+    block_sink &operator=(const block_sink &) = delete;
+
+    ~block_sink() {
+        try {
+            finish();
+        } catch (...) {
+        }
+        stop();
+    }
+
+    void write(const char *data, size_t n) {
+        size_t block_size = opts_.block_size;
+        // full blocks which are stored as they are go from data to sink without a copy
+        if (!opts_.compress && threads_.empty()) {
+            while (fill_ == 0 && n >= block_size) {
+                block_header header{static_cast<uint32_t>(block_size), static_cast<uint32_t>(block_size)};
+                write_block(header, data, seal(header, data));
+                data += block_size;
+                n -= block_size;
+            }
+        }
+        while (n > 0) {
+            size_t m = std::min(n, block_size - fill_);
+            std::memcpy(buf_.data() + fill_, data, m);
+            fill_ += m;
+            data += m;
+            n -= m;
+            if (fill_ == block_size) {
+                submit();
+            }
+        }
+    }
+
+    /**
+     * flush - write the bytes of a partial block, and wait until every block reached sink
+     */
+    void flush() {
+        if (fill_ > 0) {
+            submit();
+        }
+        if (!threads_.empty()) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return written_ == submitted_ || error_; });
+            if (error_) {
+                std::rethrow_exception(error_);
+            }
+        }
+    }
+
+    void finish() {
+        if (finished_) {
+            return;
+        }
+        finished_ = true;
+        flush();
+        stop();
+        block_header end{0, 0};
+        write_block(end, nullptr, seal(end, nullptr));
+    }
+
+private:
+    void submit() {
+        if (threads_.empty()) {
+            block_header header = pack_block(buf_.data(), fill_, packed_, opts_.compress);
+            const char *stored = stored_bytes(header, buf_.data(), packed_);
+            write_block(header, stored, seal(header, stored));
+            fill_ = 0;
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        block_slot &slot = slots_[submitted_ % slots_.size()];
+        cv_.wait(lock, [this, &slot]() { return slot.state == slot_state::free || error_; });
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+        // the slot gets the bytes and buf_ gets the storage of a block already written
+        slot.raw.swap(buf_);
+        slot.raw.resize(fill_);
+        buf_.resize(opts_.block_size);
+        fill_ = 0;
+        slot.state = slot_state::filled;
+        submitted_++;
+        cv_.notify_all();
+    }
+
+    uint32_t seal(const block_header &header, const char *stored) const {
+        return opts_.checksum ? block_checksum(header, stored) : 0;
+    }
+
+    void write_block(const block_header &header, const char *stored, uint32_t crc) {
+        block_header stored_header = little_endian(header);
+        sink_.write(reinterpret_cast<const char *>(&stored_header), sizeof(stored_header));
+        if (header.stored_size > 0) {
+            sink_.write(stored, header.stored_size);
+        }
+        if (opts_.checksum) {
+            uint32_t stored_crc = little_endian(crc);
+            sink_.write(reinterpret_cast<const char *>(&stored_crc), sizeof(stored_crc));
+        }
+    }
+
+    void start(unsigned threads) {
+        slots_ = std::vector<block_slot>(2 * threads);
+        submitted_ = compressed_ = written_ = 0;
+        stopping_ = false;
+        for (unsigned i = 0; i < threads; i++) {
+            threads_.emplace_back([this]() { compress_blocks(); });
+        }
+        threads_.emplace_back([this]() { write_blocks(); });
+    }
+
+    void stop() {
+        if (threads_.empty()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (auto &thread : threads_) {
+            thread.join();
+        }
+        threads_.clear();
+    }
+
+    void compress_blocks() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            cv_.wait(lock, [this]() { return stopping_ || compressed_ < submitted_; });
+            if (compressed_ == submitted_) {
+                return;
+            }
+            block_slot &slot = slots_[compressed_++ % slots_.size()];
+            lock.unlock();
+            try {
+                slot.header = pack_block(slot.raw.data(), slot.raw.size(), slot.packed, opts_.compress);
+                slot.crc = seal(slot.header, stored_bytes(slot.header, slot.raw.data(), slot.packed));
+            } catch (...) {
+                // the caller rethrows it from submit or flush, the block is never written
+                lock.lock();
+                if (!error_) {
+                    error_ = std::current_exception();
+                }
+                cv_.notify_all();
+                return;
+            }
+            lock.lock();
+            slot.state = slot_state::done;
+            cv_.notify_all();
+        }
+    }
+
+    // the blocks are written in the order they were submitted, whichever finished first
+    void write_blocks() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            block_slot &slot = slots_[written_ % slots_.size()];
+            cv_.wait(lock, [this, &slot]() { return stopping_ || slot.state == slot_state::done; });
+            if (slot.state != slot_state::done) {
+                return;
+            }
+            lock.unlock();
+            try {
+                write_block(slot.header, stored_bytes(slot.header, slot.raw.data(), slot.packed), slot.crc);
+            } catch (...) {
+                lock.lock();
+                if (!error_) {
+                    error_ = std::current_exception();
+                }
+                cv_.notify_all();
+                return;
+            }
+            lock.lock();
+            slot.raw.clear();
+            slot.state = slot_state::free;
+            written_++;
+            cv_.notify_all();
+        }
+    }
+
+    Sink &sink_;
+    block_options opts_;
+    bool finished_;
+    // the bytes of the current block, the first fill_ of them are written
+    std::vector<char> buf_;
+    size_t fill_;
+    std::vector<char> packed_;
+
+    std::vector<block_slot> slots_;
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    size_t submitted_, compressed_, written_;
+    bool stopping_;
+    std::exception_ptr error_;
+};
+
+/**
+ * block_source - read the blocks written by a block_sink from source, one block at a time, and
+ * throw std::invalid_argument on a block which is corrupt. With more than one thread, one more
+ * thread reads the blocks ahead from source and that many worker threads decompress them, while
+ * the caller decodes the current one
+ */
+template <typename Source>
+class block_source {
+public:
+    explicit block_source(Source &source, const block_options &opts = block_options())
+        : source_(source), opts_(opts), pos_(0), ended_(false) {
+        if (opts.threads > 1) {
+            start(opts.threads);
+        }
+    }
+
+    block_source(const block_source &) = delete;
+    block_source &operator=(const block_source &) = delete;
+
+    ~block_source() {
+        stop();
+    }
+
+    void read(char *data, size_t n) {
+        if (n == 0) {
+            return;
+        }
+        if (n <= buf_.size() - pos_) {
+            std::memcpy(data, buf_.data() + pos_, n);
+            pos_ += n;
+            return;
+        }
+        while (n > 0) {
+            if (pos_ == buf_.size() && !next_block()) {
+                throw std::out_of_range("compress::block_source: read past the end of the stream");
+            }
+            size_t m = std::min(n, buf_.size() - pos_);
+            std::memcpy(data, buf_.data() + pos_, m);
+            pos_ += m;
+            data += m;
+            n -= m;
+        }
+    }
+
+    /**
+     * finish - read the end of the stream, which must follow the bytes read so far
+     */
+    void finish() {
+        if (pos_ != buf_.size()) {
+            throw std::invalid_argument("compress::block_source: bytes are left before the end of the stream");
+        }
+        if (next_block()) {
+            throw std::invalid_argument("compress::block_source: bytes are left before the end of the stream");
+        }
+        stop();
+    }
+
+    /**
+     * skip - move past the next n bytes without copying them out
+     */
+    void skip(size_t n) {
+        while (n > 0) {
+            if (pos_ == buf_.size() && !next_block()) {
+                throw std::out_of_range("compress::block_source: read past the end of the stream");
+            }
+            size_t m = std::min(n, buf_.size() - pos_);
+            pos_ += m;
+            n -= m;
+        }
+    }
+
+    // views would point into a block which is overwritten by the next one
+    const char *borrow(size_t) {
+        throw std::invalid_argument("compress::block_source: views cannot point into decompressed blocks");
+    }
+
+private:
+    // reads the header of a block and checks it, or the end of the stream and its checksum
+    bool read_header(block_header &header) {
+        source_.read(reinterpret_cast<char *>(&header), sizeof(header));
+        header = little_endian(header);
+        if (header.raw_size == 0) {
+            if (opts_.checksum) {
+                check_block(header, nullptr, read_checksum());
+            }
+            return false;
+        }
+        check_header(header);
+        return true;
+    }
+
+    uint32_t read_checksum() {
+        uint32_t crc = 0;
+        if (opts_.checksum) {
+            source_.read(reinterpret_cast<char *>(&crc), sizeof(crc));
+            crc = little_endian(crc);
+        }
+        return crc;
+    }
+
+    // moves to the next block, or returns false at the end of the stream
+    bool next_block() {
+        if (ended_) {
+            return false;
+        }
+        pos_ = 0;
+        if (threads_.empty()) {
+            block_header header;
+            if (!read_header(header)) {
+                buf_.clear();
+                ended_ = true;
+                return false;
+            }
+            if (header.stored_size == header.raw_size) {
+                buf_.resize(header.raw_size);
+                source_.read(buf_.data(), header.raw_size);
+                verify(header, buf_.data(), read_checksum());
+                return true;
+            }
+            packed_.resize(header.stored_size);
+            source_.read(packed_.data(), header.stored_size);
+            verify(header, packed_.data(), read_checksum());
+            unpack_block(header, packed_, buf_);
+            return true;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        block_slot &slot = slots_[consumed_ % slots_.size()];
+        cv_.wait(lock, [this, &slot]() {
+            return slot.state == slot_state::done || slot.state == slot_state::failed ||
+                   (read_done_ && consumed_ == read_);
+        });
+        if (slot.state == slot_state::failed) {
+            buf_.clear();
+            std::rethrow_exception(slot.error);
+        }
+        if (slot.state != slot_state::done) {
+            buf_.clear();
+            if (read_error_) {
+                std::rethrow_exception(read_error_);
+            }
+            ended_ = true;
+            return false;
+        }
+        // the slot gets the storage of the block already read
+        buf_.swap(slot.raw);
+        slot.state = slot_state::free;
+        consumed_++;
+        cv_.notify_all();
+        return true;
+    }
+
+    void verify(const block_header &header, const char *stored, uint32_t crc) const {
+        if (opts_.checksum) {
+            check_block(header, stored, crc);
+        }
+    }
+
+    void start(unsigned threads) {
+        slots_ = std::vector<block_slot>(2 * threads);
+        read_ = decompressed_ = consumed_ = 0;
+        read_done_ = stopping_ = false;
+        threads_.emplace_back([this]() { read_blocks(); });
+        for (unsigned i = 0; i < threads; i++) {
+            threads_.emplace_back([this]() { decompress_blocks(); });
+        }
+    }
+
+    void stop() {
+        if (threads_.empty()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (auto &thread : threads_) {
+            thread.join();
+        }
+        threads_.clear();
+    }
+
+    // reads ahead until the end of the stream, which is not read past
+    void read_blocks() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            block_slot &slot = slots_[read_ % slots_.size()];
+            cv_.wait(lock, [this, &slot]() { return stopping_ || slot.state == slot_state::free; });
+            if (stopping_) {
+                return;
+            }
+            lock.unlock();
+            std::exception_ptr error;
+            bool end = false;
+            try {
+                end = !read_header(slot.header);
+                if (!end) {
+                    slot.packed.resize(slot.header.stored_size);
+                    source_.read(slot.packed.data(), slot.header.stored_size);
+                    slot.crc = read_checksum();
+                }
+            } catch (...) {
+                error = std::current_exception();
+            }
+            lock.lock();
+            if (end || error) {
+                read_error_ = error;
+                read_done_ = true;
+                cv_.notify_all();
+                return;
+            }
+            slot.state = slot_state::filled;
+            read_++;
+            cv_.notify_all();
+        }
+    }
+
+    void decompress_blocks() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            cv_.wait(lock, [this]() { return stopping_ || decompressed_ < read_; });
+            if (stopping_) {
+                return;
+            }
+            block_slot &slot = slots_[decompressed_++ % slots_.size()];
+            lock.unlock();
+            std::exception_ptr error;
+            try {
+                verify(slot.header, slot.packed.data(), slot.crc);
+                unpack_block(slot.header, slot.packed, slot.raw);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            lock.lock();
+            slot.error = error;
+            slot.state = error ? slot_state::failed : slot_state::done;
+            cv_.notify_all();
+        }
+    }
+
+    Source &source_;
+    block_options opts_;
+    size_t pos_;
+    bool ended_;
+    std::vector<char> buf_;
+    std::vector<char> packed_;
+
+    std::vector<block_slot> slots_;
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    size_t read_, decompressed_, consumed_;
+    bool read_done_, stopping_;
+    std::exception_ptr read_error_;
+};
+
+} // namespace compress
+
+#endif
\ No newline at end of file
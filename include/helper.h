@@ -6,6 +6,7 @@
 #ifndef __HELPER_H_
 #define __HELPER_H_
 
+#include <array>
 #include <fstream>
 #include <utility>
 #include <vector>
@@ -14,6 +15,12 @@
 #include <set>
 #include <tuple>
 #include <memory>
+#include <string_view>
+
+#if __cplusplus > 201703L && __has_include(<span>)
+#include <span>
+#define BINARY_HAS_SPAN 1
+#endif
 
 namespace detail {  // support string type and STL containers
 template <typename T>
@@ -41,6 +48,12 @@ struct stl_container<std::tuple<Args...>> : std::true_type {
     using tuple = std::tuple<Args...>;
 };
 
+// the length of a std::array is part of its type, so only its elements are serialized
+template <typename T, size_t N>
+struct stl_container<std::array<T, N>> : std::true_type {
+    using array = std::array<T, N>;
+};
+
 template <typename T>
 struct stl_container<std::shared_ptr<T>> : std::true_type {
     using pointer = std::shared_ptr<T>;
@@ -51,6 +64,12 @@ struct stl_container<std::unique_ptr<T>> : std::true_type {
     using pointer = std::unique_ptr<T>;
 };
 
+// written through the std::shared_ptr it locks, binary serialization only
+template <typename T>
+struct stl_container<std::weak_ptr<T>> : std::true_type {
+    using pointer = std::weak_ptr<T>;
+};
+
 template <typename T, typename = void>
 struct is_pair : std::false_type {};
 
@@ -63,19 +82,104 @@ struct is_tuple : std::false_type {};
 template <typename T>
 struct is_tuple<T, std::void_t<typename stl_container<T>::tuple>> : std::true_type {};
 
+template <typename T, typename = void>
+struct is_std_array : std::false_type {};
+
+template <typename T>
+struct is_std_array<T, std::void_t<typename stl_container<T>::array>> : std::true_type {};
+
 template <typename T, typename = void>
 struct is_smart_ptr : std::false_type {};
 
 template <typename T>
 struct is_smart_ptr<T, std::void_t<typename stl_container<T>::pointer>> : std::true_type {};
 
+template <typename T>
+struct is_bulk_element : std::integral_constant<bool, std::is_arithmetic_v<T> && !std::is_same_v<T, bool>> {};
+
+/**
+ * is_trivially_serializable - opt-in marker for plain structs of numbers, which are written as
+ * their raw bytes instead of member by member. Specialize it for such a struct:
+ *
+ *     template <>
+ *     struct detail::is_trivially_serializable<Telemetry> : std::true_type {};
+ */
+template <typename T>
+struct is_trivially_serializable : std::false_type {};
+
+// contiguous containers whose elements can be written and read as one block of raw bytes
+template <typename T>
+struct is_bulk_container : std::false_type {};
+
+template <typename T>
+struct is_bulk_container<std::vector<T>> : std::disjunction<is_bulk_element<T>, is_trivially_serializable<T>> {};
+
+// integers which the compact format writes as varints, a single byte is kept as it is
+template <typename T>
+struct is_compact_integer : std::integral_constant<bool, std::is_integral_v<T> && !std::is_same_v<T, bool> &&
+                                                         (sizeof(T) > 1)> {};
+
+// floating-point numbers which options::xor_floats writes with the XOR codec
+template <typename T>
+struct is_xor_float : std::integral_constant<bool, std::is_same_v<T, float> || std::is_same_v<T, double>> {};
+
+// the encoders and decoders of binary.h carry the options of the stream, plain sinks and
+// sources use the default ones
+template <typename T, typename = void>
+struct has_format : std::false_type {};
+
+template <typename T>
+struct has_format<T, std::void_t<decltype(std::declval<T &>().format())>> : std::true_type {};
+
+// views borrow their bytes from the buffer of the source instead of owning a copy: std::string_view
+// for strings and std::span for the elements of a bulk container
+template <typename T>
+struct is_view : std::false_type {};
+
+template <>
+struct is_view<std::string_view> : std::true_type {};
+
+template <typename T>
+struct is_span : std::false_type {};
+
+#ifdef BINARY_HAS_SPAN
+template <typename T>
+struct is_span<std::span<T>> : is_bulk_element<std::remove_const_t<T>> {};
+
+template <typename T>
+struct is_view<std::span<T>> : is_span<std::span<T>> {};
+#endif
+
+// sources over a buffer, like stream::memory_source and stream::mmap_source, can hand out a
+// pointer to their next bytes
+template <typename T, typename = void>
+struct has_borrow : std::false_type {};
+
+template <typename T>
+struct has_borrow<T, std::void_t<decltype(std::declval<T &>().borrow(size_t()))>> : std::true_type {};
+
+// sources which move past bytes without copying them out, when borrowing is not possible
+template <typename T, typename = void>
+struct has_skip : std::false_type {};
+
+template <typename T>
+struct has_skip<T, std::void_t<decltype(std::declval<T &>().skip(size_t()))>> : std::true_type {};
+
+// sources over a buffer which know how many of their bytes are left to read
+template <typename T, typename = void>
+struct has_remaining : std::false_type {};
+
+template <typename T>
+struct has_remaining<T, std::void_t<decltype(std::declval<const T &>().remaining())>> : std::true_type {};
+
 template <typename T, typename = void>
 struct is_not_user_type : std::false_type {};
 
 template <typename T>
 struct is_not_user_type<T, typename std::enable_if<stl_container<T>::value ||
                                                    std::is_arithmetic_v<T> ||
-                                                   std::is_same_v<T, std::string>>::type>
+                                                   std::is_same_v<T, std::string> ||
+                                                   is_view<T>::value>::type>
         : std::true_type {};
 
 template <typename T, typename = void>
@@ -83,9 +187,138 @@ struct has_get_all_member : std::false_type {};
 
 template <typename T>
 struct has_get_all_member<T,
-    std::void_t<typename std::enable_if<is_tuple<decltype(std::declval<T>().get_all_member())>::value>::type>>
+    std::void_t<typename std::enable_if<is_tuple<std::decay_t<decltype(std::declval<T &>().get_all_member())>>::value>::type>>
         : std::true_type {};
 
+// the members a trivially serializable struct may have, a pointer would dangle once read back
+template <typename T>
+struct is_pointer_free : std::disjunction<std::is_arithmetic<T>, std::is_enum<T>, is_trivially_serializable<T>> {};
+
+template <typename T, size_t N>
+struct is_pointer_free<T[N]> : is_pointer_free<T> {};
+
+template <typename T>
+struct is_pointer_free_tuple : std::false_type {};
+
+template <typename... Args>
+struct is_pointer_free_tuple<std::tuple<Args...>>
+        : std::conjunction<is_pointer_free<std::remove_cv_t<std::remove_reference_t<Args>>>...> {};
+
+// the members can only be checked when get_all_member lists them
+template <typename T, typename = void>
+struct has_pointer_free_members : std::true_type {};
+
+template <typename T>
+struct has_pointer_free_members<T, typename std::enable_if<has_get_all_member<T>::value>::type>
+        : is_pointer_free_tuple<std::decay_t<decltype(std::declval<T &>().get_all_member())>> {};
+
+/**
+ * check_trivially_serializable - reject the layouts which cannot be copied as raw bytes
+ */
+template <typename T>
+constexpr void check_trivially_serializable() {
+    static_assert(std::is_trivially_copyable_v<T>, "binary: a trivially serializable type must be trivially copyable");
+    static_assert(!std::is_pointer_v<T> && has_pointer_free_members<T>::value,
+                  "binary: a trivially serializable type must not hold pointers");
+}
+
+template <typename T>
+struct is_reference_tuple : std::false_type {};
+
+template <typename... Args>
+struct is_reference_tuple<std::tuple<Args...>> : std::conjunction<std::is_lvalue_reference<Args>...> {};
+
+// get_all_member returns references to the members, like std::tie(a, b, c), so the members can be
+// read and written in place instead of through a copy of them
+template <typename T, typename = void>
+struct has_member_references : std::false_type {};
+
+template <typename T>
+struct has_member_references<T, typename std::enable_if<has_get_all_member<T>::value>::type>
+        : is_reference_tuple<std::decay_t<decltype(std::declval<T &>().get_all_member())>> {};
+
+// user types whose std::vector can be written in columns, one per member of get_all_member
+template <typename T>
+struct is_columnar_element
+        : std::integral_constant<bool, !is_not_user_type<T>::value && has_get_all_member<T>::value &&
+                                       !is_trivially_serializable<T>::value> {};
+
+// types which hold a std::shared_ptr or a std::weak_ptr, whose objects get ids as they are read
+template <typename T, typename = void>
+struct holds_shared : std::false_type {};
+
+template <typename T>
+struct holds_shared<std::shared_ptr<T>> : std::true_type {};
+
+template <typename T>
+struct holds_shared<std::weak_ptr<T>> : std::true_type {};
+
+template <typename T>
+struct holds_shared<std::unique_ptr<T>> : holds_shared<T> {};
+
+template <typename T>
+struct holds_shared<std::vector<T>> : holds_shared<T> {};
+
+template <typename T>
+struct holds_shared<std::list<T>> : holds_shared<T> {};
+
+template <typename T>
+struct holds_shared<std::set<T>> : holds_shared<T> {};
+
+template <typename T, size_t N>
+struct holds_shared<std::array<T, N>> : holds_shared<T> {};
+
+template <typename T1, typename T2>
+struct holds_shared<std::map<T1, T2>> : std::disjunction<holds_shared<T1>, holds_shared<T2>> {};
+
+template <typename T1, typename T2>
+struct holds_shared<std::pair<T1, T2>> : std::disjunction<holds_shared<T1>, holds_shared<T2>> {};
+
+template <typename... Args>
+struct holds_shared<std::tuple<Args...>> : std::disjunction<holds_shared<std::decay_t<Args>>...> {};
+
+template <typename T>
+struct holds_shared<T, typename std::enable_if<is_columnar_element<T>::value>::type>
+        : holds_shared<std::decay_t<decltype(std::declval<T &>().get_all_member())>> {};
+
+// types which hold a view, whose bytes stay in the buffer they were deserialized from
+template <typename T, typename = void>
+struct holds_view : is_view<T> {};
+
+template <typename T>
+struct holds_view<std::shared_ptr<T>> : holds_view<T> {};
+
+template <typename T>
+struct holds_view<std::weak_ptr<T>> : holds_view<T> {};
+
+template <typename T>
+struct holds_view<std::unique_ptr<T>> : holds_view<T> {};
+
+template <typename T>
+struct holds_view<std::vector<T>> : holds_view<T> {};
+
+template <typename T>
+struct holds_view<std::list<T>> : holds_view<T> {};
+
+template <typename T>
+struct holds_view<std::set<T>> : holds_view<T> {};
+
+template <typename T, size_t N>
+struct holds_view<std::array<T, N>> : holds_view<T> {};
+
+template <typename T1, typename T2>
+struct holds_view<std::map<T1, T2>> : std::disjunction<holds_view<T1>, holds_view<T2>> {};
+
+template <typename T1, typename T2>
+struct holds_view<std::pair<T1, T2>> : std::disjunction<holds_view<T1>, holds_view<T2>> {};
+
+template <typename... Args>
+struct holds_view<std::tuple<Args...>> : std::disjunction<holds_view<std::decay_t<Args>>...> {};
+
+template <typename T>
+struct holds_view<T, typename std::enable_if<is_columnar_element<T>::value>::type>
+        : holds_view<std::decay_t<decltype(std::declval<T &>().get_all_member())>> {};
+
 } // namespace detail
 
 namespace tuple_helper {
@@ -132,9 +365,10 @@ void tuple_for_each(Func &&f, Tuple &tup) {
     tuple_for_each_helper(std::forward<Func>(f), tuple_index(), std::forward<Tuple>(tup));
 }
 
+// the members are moved out of tup, so the buffers they own are handed over to val without a copy
 template <typename T, int... Index, typename... Args>
 void construct_object_helper(T &val, IndexTuple<Index...>, std::tuple<Args...> &tup) {
-    val = T(std::get<Index>(tup)...);
+    val = T(std::move(std::get<Index>(tup))...);
 }
 
 template <typename T, typename... Args>
@@ -0,0 +1,449 @@
+/**
+ * stream.h - the sinks and sources of binary serialization and deserialization. A sink is any
+ * type with a member write(const char *data, size_t n) and a source is any type with a member
+ * read(char *data, size_t n), so std::fstream can also be used as both directly
+ */
+
+#ifndef __STREAM_H_
+#define __STREAM_H_
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <istream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace stream {
+
+/**
+ * memory_sink - append the serialized bytes to a std::vector<char>, no system call is made
+ */
+class memory_sink {
+public:
+    explicit memory_sink(std::vector<char> &buf) : buf_(buf) {}
+
+    void write(const char *data, size_t n) {
+        buf_.insert(buf_.end(), data, data + n);
+    }
+
+    void reserve(size_t n) {
+        buf_.reserve(buf_.size() + n);
+    }
+
+    size_t size() const {
+        return buf_.size();
+    }
+
+private:
+    std::vector<char> &buf_;
+};
+
+/**
+ * counting_sink - count the serialized bytes and drop them, which measures a stream of any
+ * length in constant memory
+ */
+class counting_sink {
+public:
+    counting_sink() : size_(0) {}
+
+    void write(const char *, size_t n) {
+        size_ += n;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+private:
+    size_t size_;
+};
+
+/**
+ * buffer_sink - write the serialized bytes to a buffer provided by the caller, throw
+ * std::length_error when the buffer is full
+ */
+class buffer_sink {
+public:
+    buffer_sink(char *data, size_t capacity) : data_(data), capacity_(capacity), size_(0) {}
+
+    void write(const char *data, size_t n) {
+        if (n == 0) {
+            return;
+        }
+        if (n > capacity_ - size_) {
+            throw std::length_error("stream::buffer_sink: the buffer is full");
+        }
+        std::memcpy(data_ + size_, data, n);
+        size_ += n;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+private:
+    char *data_;
+    size_t capacity_;
+    size_t size_;
+};
+
+/**
+ * memory_source - read the serialized bytes from a buffer, throw std::out_of_range when
+ * reading past its end
+ */
+class memory_source {
+public:
+    memory_source(const char *data, size_t size) : data_(data), size_(size), pos_(0) {}
+
+    explicit memory_source(const std::vector<char> &buf) : memory_source(buf.data(), buf.size()) {}
+
+    void read(char *data, size_t n) {
+        if (n == 0) {
+            return;
+        }
+        if (n > size_ - pos_) {
+            throw std::out_of_range("stream::memory_source: read past the end of the buffer");
+        }
+        std::memcpy(data, data_ + pos_, n);
+        pos_ += n;
+    }
+
+    /**
+     * borrow - skip the next n bytes and return a pointer to them, which stays valid as long as
+     * the buffer does
+     */
+    const char *borrow(size_t n) {
+        if (n > size_ - pos_) {
+            throw std::out_of_range("stream::memory_source: read past the end of the buffer");
+        }
+        const char *data = data_ + pos_;
+        pos_ += n;
+        return data;
+    }
+
+    size_t position() const {
+        return pos_;
+    }
+
+    size_t remaining() const {
+        return size_ - pos_;
+    }
+
+private:
+    const char *data_;
+    size_t size_;
+    size_t pos_;
+};
+
+/**
+ * fd_sink - buffered sink over a file descriptor, which is not closed by the sink. The
+ * buffered bytes are written by flush() or the destructor
+ */
+class fd_sink {
+public:
+    explicit fd_sink(int fd, size_t buffer_size = 1 << 16) : fd_(fd), buf_(buffer_size), size_(0), written_(0) {}
+
+    fd_sink(const fd_sink &) = delete;
+    fd_sink &operator=(const fd_sink &) = delete;
+
+    ~fd_sink() {
+        try {
+            flush();
+        } catch (...) {
+        }
+    }
+
+    void write(const char *data, size_t n) {
+        written_ += n;
+        if (n > buf_.size() - size_) {
+            if (n >= buf_.size()) {
+                // the buffered bytes and data go out in one system call
+                write_all(buf_.data(), size_, data, n);
+                size_ = 0;
+                return;
+            }
+            flush();
+        }
+        std::memcpy(buf_.data() + size_, data, n);
+        size_ += n;
+    }
+
+    void flush() {
+        size_t n = size_;
+        size_ = 0;
+        write_all(buf_.data(), n);
+    }
+
+    /**
+     * size - the number of bytes written to the sink, flushed or still buffered
+     */
+    size_t size() const {
+        return written_;
+    }
+
+private:
+    void write_all(const char *data, size_t n) {
+        while (n > 0) {
+            ssize_t written = ::write(fd_, data, n);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::system_error(errno, std::generic_category(), "stream::fd_sink");
+            }
+            data += written;
+            n -= written;
+        }
+    }
+
+    void write_all(const char *head, size_t head_size, const char *data, size_t n) {
+        while (head_size > 0) {
+            struct iovec iov[2] = {{const_cast<char *>(head), head_size}, {const_cast<char *>(data), n}};
+            ssize_t written = ::writev(fd_, iov, 2);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::system_error(errno, std::generic_category(), "stream::fd_sink");
+            }
+            size_t done = written;
+            if (done < head_size) {
+                head += done;
+                head_size -= done;
+                continue;
+            }
+            data += done - head_size;
+            n -= done - head_size;
+            head_size = 0;
+        }
+        write_all(data, n);
+    }
+
+    int fd_;
+    std::vector<char> buf_;
+    size_t size_;
+    size_t written_;
+};
+
+/**
+ * fd_source - buffered source over a file descriptor, which is not closed by the source
+ */
+class fd_source {
+public:
+    explicit fd_source(int fd, size_t buffer_size = 1 << 16) : fd_(fd), buf_(buffer_size), pos_(0), size_(0) {}
+
+    fd_source(const fd_source &) = delete;
+    fd_source &operator=(const fd_source &) = delete;
+
+    void read(char *data, size_t n) {
+        size_t avail = size_ - pos_;
+        if (n <= avail) {
+            std::memcpy(data, buf_.data() + pos_, n);
+            pos_ += n;
+            return;
+        }
+        std::memcpy(data, buf_.data() + pos_, avail);
+        data += avail;
+        n -= avail;
+        pos_ = size_ = 0;
+        if (n >= buf_.size()) {
+            read_all(data, n);
+            return;
+        }
+        while (size_ < n) {
+            size_ += read_some(buf_.data() + size_, buf_.size() - size_);
+        }
+        std::memcpy(data, buf_.data(), n);
+        pos_ = n;
+    }
+
+private:
+    size_t read_some(char *data, size_t n) {
+        for (;;) {
+            ssize_t got = ::read(fd_, data, n);
+            if (got > 0) {
+                return got;
+            }
+            if (got == 0) {
+                throw std::out_of_range("stream::fd_source: read past the end of the file");
+            }
+            if (errno != EINTR) {
+                throw std::system_error(errno, std::generic_category(), "stream::fd_source");
+            }
+        }
+    }
+
+    void read_all(char *data, size_t n) {
+        while (n > 0) {
+            size_t got = read_some(data, n);
+            data += got;
+            n -= got;
+        }
+    }
+
+    int fd_;
+    std::vector<char> buf_;
+    size_t pos_;
+    size_t size_;
+};
+
+/**
+ * file_sink - sink over a FILE *, buffered by stdio, which is not closed by the sink
+ */
+class file_sink {
+public:
+    explicit file_sink(FILE *file) : file_(file) {}
+
+    void write(const char *data, size_t n) {
+        if (std::fwrite(data, 1, n, file_) != n) {
+            throw std::system_error(errno, std::generic_category(), "stream::file_sink");
+        }
+    }
+
+    void flush() {
+        std::fflush(file_);
+    }
+
+private:
+    FILE *file_;
+};
+
+/**
+ * file_source - source over a FILE *, buffered by stdio, which is not closed by the source
+ */
+class file_source {
+public:
+    explicit file_source(FILE *file) : file_(file) {}
+
+    void read(char *data, size_t n) {
+        if (std::fread(data, 1, n, file_) != n) {
+            throw std::out_of_range("stream::file_source: read past the end of the file");
+        }
+    }
+
+private:
+    FILE *file_;
+};
+
+/**
+ * istream_source - source over a std::istream, which throws std::out_of_range when a read comes
+ * short instead of leaving the stream failed and the bytes unread
+ */
+class istream_source {
+public:
+    explicit istream_source(std::istream &is) : is_(is) {}
+
+    void read(char *data, size_t n) {
+        if (!is_.read(data, n)) {
+            throw std::out_of_range("stream::istream_source: read past the end of the stream");
+        }
+    }
+
+private:
+    std::istream &is_;
+};
+
+/**
+ * mmap_source - source over a memory mapped file, the bytes are copied out of the mapped pages
+ * without a system call per read. The kernel is told the file is read sequentially, and with
+ * populate set all pages are faulted in by mmap itself
+ */
+class mmap_source {
+public:
+    explicit mmap_source(const std::string &file_name, bool populate = false) : data_(nullptr), size_(0), pos_(0) {
+        int fd = ::open(file_name.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "stream::mmap_source: " + file_name);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) < 0) {
+            int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), "stream::mmap_source: " + file_name);
+        }
+        size_ = st.st_size;
+        if (size_ > 0) {
+            int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+            if (populate) {
+                flags |= MAP_POPULATE;
+            }
+#endif
+            void *addr = ::mmap(nullptr, size_, PROT_READ, flags, fd, 0);
+            if (addr == MAP_FAILED) {
+                int err = errno;
+                ::close(fd);
+                throw std::system_error(err, std::generic_category(), "stream::mmap_source: " + file_name);
+            }
+            data_ = static_cast<const char *>(addr);
+            // only hints, a failure does not matter
+            ::madvise(addr, size_, MADV_SEQUENTIAL);
+            ::madvise(addr, size_, MADV_WILLNEED);
+        }
+        // the mapping stays valid after the descriptor is closed
+        ::close(fd);
+    }
+
+    mmap_source(const mmap_source &) = delete;
+    mmap_source &operator=(const mmap_source &) = delete;
+
+    ~mmap_source() {
+        if (data_ != nullptr) {
+            ::munmap(const_cast<char *>(data_), size_);
+        }
+    }
+
+    void read(char *data, size_t n) {
+        if (n == 0) {
+            return;
+        }
+        if (n > size_ - pos_) {
+            throw std::out_of_range("stream::mmap_source: read past the end of the file");
+        }
+        std::memcpy(data, data_ + pos_, n);
+        pos_ += n;
+    }
+
+    /**
+     * borrow - skip the next n bytes and return a pointer to them, which stays valid until the
+     * source is destroyed
+     */
+    const char *borrow(size_t n) {
+        if (n > size_ - pos_) {
+            throw std::out_of_range("stream::mmap_source: read past the end of the file");
+        }
+        const char *data = data_ + pos_;
+        pos_ += n;
+        return data;
+    }
+
+    size_t position() const {
+        return pos_;
+    }
+
+    size_t remaining() const {
+        return size_ - pos_;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+private:
+    const char *data_;
+    size_t size_;
+    size_t pos_;
+};
+
+} // namespace stream
+
+#endif
\ No newline at end of file
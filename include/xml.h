@@ -185,13 +185,22 @@ deserialize_xml_helper(T &val, tinyxml2::XMLElement *attr) {
 
 template <typename T>
 typename std::enable_if<!detail::is_not_user_type<std::remove_reference_t<T>>::value &&
-                        detail::has_get_all_member<std::remove_reference_t<T>>::value>::type
+                        detail::has_get_all_member<std::remove_reference_t<T>>::value &&
+                        !detail::has_member_references<std::remove_reference_t<T>>::value>::type
 deserialize_xml_helper(T &val, tinyxml2::XMLElement *attr) {
-    decltype(val.get_all_member()) tup;
+    std::decay_t<decltype(val.get_all_member())> tup;
     deserialize_xml_helper(tup, attr);
     tuple_helper::construct_object(val, tup);
 }
 
+template <typename T>
+typename std::enable_if<!detail::is_not_user_type<std::remove_reference_t<T>>::value &&
+                        detail::has_member_references<std::remove_reference_t<T>>::value>::type
+deserialize_xml_helper(T &val, tinyxml2::XMLElement *attr) {
+    auto members = val.get_all_member();
+    deserialize_xml_helper(members, attr);
+}
+
 template <typename T>
 typename std::enable_if<std::is_arithmetic_v<std::remove_reference_t<T>>>::type
 deserialize_xml(T &val, std::string object_name, std::string file_name) {
@@ -0,0 +1,1334 @@
+#include "../include/binary.h"
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <random>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+/**
+ * time_ms - run f once and return the elapsed wall time in milliseconds
+ */
+template <typename Func>
+double time_ms(Func &&f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/**
+ * best_ms - run f runs times and return the shortest elapsed wall time in milliseconds
+ */
+template <typename Func>
+double best_ms(int runs, Func &&f) {
+    double best = time_ms(f);
+    for (int i = 1; i < runs; i++) {
+        best = std::min(best, time_ms(f));
+    }
+    return best;
+}
+
+/**
+ * report - print one benchmark line with the throughput over bytes
+ */
+void report(const std::string &name, double ms, size_t bytes) {
+    std::cout << "  " << name << ": " << ms << " ms, " << (bytes / 1048576.0) / (ms / 1000.0) << " MB/s\n";
+}
+
+/**
+ * selected - whether the benchmark called name should run, all run when no filter is given
+ */
+bool selected(int argc, char **argv, const char *name) {
+    if (argc < 2) {
+        return true;
+    }
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * bench_bulk - std::vector<double> written and read element by element versus as one block
+ */
+void bench_bulk() {
+    const int n = 4 << 20;
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    std::vector<double> v1(n);
+    for (auto &d : v1) {
+        d = dist(rng);
+    }
+    size_t bytes = sizeof(double) * n;
+
+    std::cout << "std::vector<double> with " << n << " elements:\n";
+    double ms = time_ms([&]() {
+        std::fstream fs("bench_bulk.data", std::ios_base::out | std::ios_base::binary);
+        int len = v1.size();
+        binary::serialize_helper(len, fs);
+        for (auto &d : v1) {
+            binary::serialize_helper(d, fs);
+        }
+    });
+    report("per-element serialize", ms, bytes);
+
+    std::vector<double> v2;
+    ms = time_ms([&]() {
+        std::fstream fs("bench_bulk.data", std::ios_base::in | std::ios_base::binary);
+        int len;
+        binary::deserialize_helper(len, fs);
+        for (int i = 0; i < len; i++) {
+            double d;
+            binary::deserialize_helper(d, fs);
+            v2.emplace_back(d);
+        }
+    });
+    report("per-element deserialize", ms, bytes);
+
+    ms = time_ms([&]() { binary::serialize(v1, "bench_bulk.data"); });
+    report("bulk serialize", ms, bytes);
+
+    std::vector<double> v3;
+    ms = time_ms([&]() { binary::deserialize(v3, "bench_bulk.data"); });
+    report("bulk deserialize", ms, bytes);
+
+    std::cout << (v1 == v2 && v1 == v3 ? "[true]\n" : "[false]\n");
+}
+
+/**
+ * legacy_read_string - the std::string deserialization before reading into the string directly,
+ * a stack buffer is filled first and the string is then constructed from it
+ */
+void legacy_read_string(std::string &val, stream::memory_source &source) {
+    int len;
+    source.read(reinterpret_cast<char *>(&len), sizeof(int));
+    char s[len + 1];
+    source.read(s, len);
+    s[len] = '\0';
+    val = std::string(s);
+}
+
+/**
+ * bench_string - std::vector<std::string> of mixed sizes read from memory
+ */
+void bench_string() {
+    const int n = 50000;
+    const size_t sizes[] = {4, 12, 40, 200, 3000, 20000};
+    std::mt19937_64 rng(42);
+    std::vector<std::string> v1(n);
+    size_t bytes = 0;
+    for (auto &s : v1) {
+        s.assign(sizes[rng() % 6], static_cast<char>('a' + rng() % 26));
+        bytes += s.size();
+    }
+    std::vector<char> buf;
+    stream::memory_sink sink(buf);
+    binary::serialize_to(v1, sink);
+
+    std::cout << "std::vector<std::string> with " << n << " strings of mixed sizes:\n";
+    std::vector<std::string> v2;
+    double ms = time_ms([&]() {
+        stream::memory_source source(buf);
+        int len;
+        binary::deserialize_helper(len, source);
+        v2.resize(len);
+        for (auto &s : v2) {
+            legacy_read_string(s, source);
+        }
+    });
+    report("stack buffer deserialize", ms, bytes);
+    bool same = v1 == v2;
+    // give the memory back, so both runs allocate from a warm heap
+    std::vector<std::string>().swap(v2);
+
+    std::vector<std::string> v3;
+    ms = time_ms([&]() {
+        stream::memory_source source(buf);
+        binary::deserialize_from(v3, source);
+    });
+    report("direct deserialize", ms, bytes);
+
+    std::cout << (same && v1 == v3 ? "[true]\n" : "[false]\n");
+}
+
+struct Record {
+    int id;
+    long long timestamp;
+    double value;
+    std::string tag;
+    std::vector<int> counts;
+
+    auto get_all_member() -> decltype(auto) {
+        return std::tie(id, timestamp, value, tag, counts);
+    }
+
+    bool operator==(const Record &rhs) const {
+        return id == rhs.id && timestamp == rhs.timestamp && value == rhs.value && tag == rhs.tag &&
+               counts == rhs.counts;
+    }
+};
+
+/**
+ * bench_format - fixed width and compact encoding of records with small integers
+ */
+void bench_format(const std::string &name, const binary::options &opts, std::vector<Record> &v1) {
+    std::vector<char> buf;
+    stream::memory_sink sink(buf);
+    double ms = time_ms([&]() { binary::serialize_to(v1, sink, opts); });
+    std::cout << "  " << name << " size: " << buf.size() << " bytes\n";
+    report(name + " serialize", ms, buf.size());
+
+    std::vector<Record> v2;
+    ms = time_ms([&]() {
+        stream::memory_source source(buf);
+        binary::deserialize_from(v2, source, opts);
+    });
+    report(name + " deserialize", ms, buf.size());
+    std::cout << (v1 == v2 ? "[true]\n" : "[false]\n");
+}
+
+void bench_compact() {
+    const int n = 200000;
+    std::mt19937_64 rng(42);
+    std::vector<Record> v1(n);
+    for (int i = 0; i < n; i++) {
+        v1[i].id = i;
+        v1[i].timestamp = 1700000000ll + i;
+        v1[i].value = i * 0.5;
+        v1[i].tag = "tag" + std::to_string(rng() % 100);
+        v1[i].counts.resize(rng() % 16);
+        for (auto &c : v1[i].counts) {
+            c = rng() % 200;
+        }
+    }
+    std::cout << "std::vector<Record> with " << n << " records:\n";
+    binary::options compact;
+    compact.compact = true;
+    bench_format("fixed", binary::options(), v1);
+    bench_format("compact", compact, v1);
+}
+
+/**
+ * bench_packed - the stream VByte kernels and the compact std::vector<int> against a varint per
+ * integer
+ */
+void bench_packed() {
+    const size_t n = 16 << 20;
+    std::mt19937_64 rng(42);
+    std::vector<uint32_t> ids(n);
+    for (auto &id : ids) {
+        // mostly small ids with some large ones
+        id = static_cast<uint32_t>(rng()) >> (8 * (rng() % 4));
+    }
+    size_t bytes = sizeof(uint32_t) * n;
+    std::vector<uint8_t> control(codec::svb_control_size(n)), data(4 * n + codec::svb_padding);
+    codec::svb_encode32(ids.data(), n, control.data(), data.data());
+    std::vector<uint32_t> out(n + codec::svb_padding);
+
+    std::cout << "stream VByte decode of " << n << " integers:\n";
+    std::vector<char> varints(codec::max_varint_size * n);
+    size_t len = 0;
+    for (auto id : ids) {
+        len += codec::encode_varint(id, varints.data() + len);
+    }
+    double ms = time_ms([&]() {
+        stream::memory_source source(varints.data(), len);
+        for (size_t i = 0; i < n; i++) {
+            out[i] = static_cast<uint32_t>(detail::read_varint(source));
+        }
+    });
+    report("varint per integer", ms, bytes);
+    ms = time_ms([&]() { codec::svb_decode32_scalar(control.data(), data.data(), n, out.data()); });
+    report("scalar", ms, bytes);
+#ifdef CODEC_X86_KERNELS
+    if (__builtin_cpu_supports("ssse3")) {
+        ms = time_ms([&]() { codec::svb_decode32_ssse3(control.data(), data.data(), n, out.data()); });
+        report("ssse3", ms, bytes);
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        ms = time_ms([&]() { codec::svb_decode32_avx2(control.data(), data.data(), n, out.data()); });
+        report("avx2", ms, bytes);
+    }
+#endif
+    out.resize(n);
+    bool same = out == ids;
+
+    std::vector<int> v1(ids.begin(), ids.end()), v2;
+    std::vector<char> buf;
+    stream::memory_sink sink(buf);
+    binary::options compact;
+    compact.compact = true;
+    ms = time_ms([&]() { binary::serialize_to(v1, sink, compact); });
+    report("compact std::vector<int> serialize", ms, bytes);
+    ms = time_ms([&]() {
+        stream::memory_source source(buf);
+        binary::deserialize_from(v2, source, compact);
+    });
+    report("compact std::vector<int> deserialize", ms, bytes);
+    std::cout << "  compact size: " << buf.size() << " bytes, fixed size: " << bytes << " bytes\n";
+
+    std::vector<uint64_t> ids64(n);
+    for (auto &id : ids64) {
+        // mostly small ids with some of every length up to 64 bits
+        id = rng() >> (16 * (rng() % 4));
+    }
+    bytes = sizeof(uint64_t) * n;
+    std::vector<uint8_t> data64(8 * n + codec::svb_padding);
+    codec::svb_encode64(ids64.data(), n, control.data(), data64.data());
+    std::vector<uint64_t> out64(n + codec::svb_padding);
+    std::cout << "stream VByte decode of " << n << " 64-bit integers:\n";
+    ms = time_ms([&]() { codec::svb_decode64_scalar(control.data(), data64.data(), n, out64.data()); });
+    report("scalar", ms, bytes);
+#ifdef CODEC_X86_KERNELS
+    if (__builtin_cpu_supports("ssse3")) {
+        ms = time_ms([&]() { codec::svb_decode64_ssse3(control.data(), data64.data(), n, out64.data()); });
+        report("ssse3", ms, bytes);
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        ms = time_ms([&]() { codec::svb_decode64_avx2(control.data(), data64.data(), n, out64.data()); });
+        report("avx2", ms, bytes);
+    }
+#endif
+    out64.resize(n);
+    same = same && out64 == ids64;
+    std::cout << (same && v1 == v2 ? "[true]\n" : "[false]\n");
+}
+
+/**
+ * drop_cache - evict the pages of file_name from the page cache, so the next load is a cold one
+ */
+void drop_cache(const std::string &file_name) {
+    int fd = open(file_name.c_str(), O_RDONLY);
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+/**
+ * bench_load - load file_name through std::fstream, a file descriptor and a memory mapping,
+ * each with a cold and a warm page cache
+ */
+template <typename T>
+void bench_load(const std::string &file_name, const T &expected) {
+    struct stat st;
+    stat(file_name.c_str(), &st);
+    size_t bytes = st.st_size;
+    bool same = true;
+    auto run = [&](const std::string &name, auto &&load) {
+        for (bool cold : {true, false}) {
+            if (cold) {
+                drop_cache(file_name);
+            }
+            T val;
+            double ms = time_ms([&]() { load(val); });
+            report(name + (cold ? " cold" : " warm"), ms, bytes);
+            same = same && val == expected;
+        }
+    };
+    run("std::fstream", [&](T &val) { binary::deserialize(val, file_name); });
+    run("fd_source", [&](T &val) {
+        int fd = open(file_name.c_str(), O_RDONLY);
+        stream::fd_source source(fd);
+        binary::deserialize_from(val, source);
+        close(fd);
+    });
+    run("mmap_source", [&](T &val) { binary::deserialize_mapped(val, file_name); });
+    run("mmap_source populate", [&](T &val) { binary::deserialize_mapped(val, file_name, binary::options(), true); });
+    std::cout << (same ? "[true]\n" : "[false]\n");
+}
+
+void bench_mmap() {
+    const int n = 32 << 20;
+    std::vector<double> v1(n);
+    for (int i = 0; i < n; i++) {
+        v1[i] = i * 0.25;
+    }
+    binary::serialize(v1, "bench_mmap_v.data");
+    std::cout << "std::vector<double> with " << n << " elements:\n";
+    bench_load("bench_mmap_v.data", v1);
+
+    const int m = 1 << 20;
+    std::vector<Record> r1(m);
+    for (int i = 0; i < m; i++) {
+        r1[i].id = i;
+        r1[i].timestamp = 1700000000ll + i;
+        r1[i].value = i * 0.5;
+        r1[i].tag = "tag" + std::to_string(i % 100);
+        r1[i].counts.assign(i % 8, i);
+    }
+    binary::serialize(r1, "bench_mmap_r.data");
+    std::cout << "std::vector<Record> with " << m << " records:\n";
+    bench_load("bench_mmap_r.data", r1);
+}
+
+/**
+ * bench_views - std::vector<std::string> deserialized into owning strings versus into views of the
+ * buffer
+ */
+void bench_views() {
+    const int n = 1 << 20;
+    std::mt19937_64 rng(42);
+    std::vector<std::string> v1(n);
+    size_t bytes = 0;
+    for (auto &s : v1) {
+        s.assign(16 + rng() % 48, static_cast<char>('a' + rng() % 26));
+        bytes += s.size();
+    }
+    std::vector<char> buf;
+    stream::memory_sink sink(buf);
+    binary::serialize_to(v1, sink);
+
+    std::cout << "std::vector<std::string> with " << n << " strings:\n";
+    std::vector<std::string> v2;
+    double ms = time_ms([&]() {
+        stream::memory_source source(buf);
+        binary::deserialize_from(v2, source);
+    });
+    report("std::string deserialize", ms, bytes);
+
+    std::vector<std::string_view> v3;
+    ms = time_ms([&]() {
+        stream::memory_source source(buf);
+        binary::deserialize_from(v3, source);
+    });
+    report("std::string_view deserialize", ms, bytes);
+    std::cout << (v1 == v2 && std::equal(v1.begin(), v1.end(), v3.begin(), v3.end()) ? "[true]\n" : "[false]\n");
+}
+
+struct Sample {
+    int sensor;
+    double value;
+    long long timestamp;
+    double min, max;
+
+    auto get_all_member() -> decltype(auto) {
+        return std::tie(sensor, value, timestamp, min, max);
+    }
+
+    bool operator==(const Sample &rhs) const {
+        return sensor == rhs.sensor && value == rhs.value && timestamp == rhs.timestamp && min == rhs.min &&
+               max == rhs.max;
+    }
+};
+
+// the same record, opted in to be written as raw bytes
+struct RawSample : Sample {};
+
+template <>
+struct detail::is_trivially_serializable<RawSample> : std::true_type {};
+
+template <typename T>
+void bench_records(const std::string &name, std::vector<T> &v1) {
+    std::vector<char> buf;
+    stream::memory_sink sink(buf);
+    double ms = time_ms([&]() { binary::serialize_to(v1, sink); });
+    report(name + " serialize", ms, buf.size());
+    std::vector<T> v2;
+    ms = time_ms([&]() {
+        stream::memory_source source(buf);
+        binary::deserialize_from(v2, source);
+    });
+    report(name + " deserialize", ms, buf.size());
+    std::cout << (v1 == v2 ? "[true]\n" : "[false]\n");
+}
+
+/**
+ * bench_trivial - std::vector of a plain struct written member by member versus as raw bytes
+ */
+void bench_trivial() {
+    const int n = 1 << 20;
+    std::vector<Sample> v1(n);
+    for (int i = 0; i < n; i++) {
+        v1[i] = Sample{i, i * 0.5, 1700000000ll + i, i * 0.25, i * 0.75};
+    }
+    std::vector<RawSample> v2(n);
+    for (int i = 0; i < n; i++) {
+        static_cast<Sample &>(v2[i]) = v1[i];
+    }
+    std::cout << "std::vector of " << n << " records:\n";
+    bench_records("member by member", v1);
+    bench_records("raw bytes", v2);
+}
+
+/**
+ * bench_ordered - std::map and std::set rebuilt with a plain emplace per entry versus with the
+ * end of the container as the hint
+ */
+template <typename Entry, typename T>
+void bench_ordered(const std::string &name, T &v1) {
+    std::vector<char> buf;
+    stream::memory_sink sink(buf);
+    binary::serialize_to(v1, sink);
+
+    T v2;
+    double ms = time_ms([&]() {
+        stream::memory_source source(buf);
+        size_t size = detail::read_size(source);
+        detail::read_sequence<Entry>(size, source, [&v2](Entry &&value) {
+            v2.emplace(std::move(value));
+        });
+    });
+    report(name + " emplace", ms, buf.size());
+
+    T v3;
+    ms = time_ms([&]() {
+        stream::memory_source source(buf);
+        binary::deserialize_from(v3, source);
+    });
+    report(name + " hinted emplace", ms, buf.size());
+    std::cout << (v1 == v2 && v1 == v3 ? "[true]\n" : "[false]\n");
+}
+
+void bench_presized() {
+    const int n = 1000000;
+    std::mt19937_64 rng(42);
+    std::map<int, double> m1;
+    std::set<std::string> s1;
+    while (static_cast<int>(m1.size()) < n) {
+        m1.emplace(static_cast<int>(rng()), (rng() % 1000) * 0.5);
+    }
+    while (static_cast<int>(s1.size()) < n) {
+        s1.emplace("key" + std::to_string(rng()));
+    }
+    std::cout << "ordered containers with " << n << " entries:\n";
+    bench_ordered<std::pair<int, double>>("std::map<int, double>", m1);
+    bench_ordered<std::string>("std::set<std::string>", s1);
+}
+
+/**
+ * bench_reuse - the same message deserialized many times into a fresh object versus into one
+ * reused object
+ */
+void bench_reuse() {
+    const int n = 100, loops = 20000;
+    std::vector<Record> v1(n);
+    for (int i = 0; i < n; i++) {
+        v1[i] = Record{i, 1700000000ll + i, i * 0.5, "a tag longer than the small string buffer", {i, i + 1, i + 2}};
+    }
+    std::vector<char> buf;
+    stream::memory_sink sink(buf);
+    binary::serialize_to(v1, sink);
+    size_t bytes = buf.size() * loops;
+
+    std::cout << "std::vector<Record> with " << n << " records deserialized " << loops << " times:\n";
+    bool same = true;
+    double ms = time_ms([&]() {
+        for (int i = 0; i < loops; i++) {
+            std::vector<Record> v2;
+            stream::memory_source source(buf);
+            binary::deserialize_from(v2, source);
+            same = same && v2.size() == v1.size();
+        }
+    });
+    report("fresh object", ms, bytes);
+
+    binary::options reuse;
+    reuse.reuse = true;
+    std::vector<Record> v3;
+    ms = time_ms([&]() {
+        for (int i = 0; i < loops; i++) {
+            stream::memory_source source(buf);
+            binary::deserialize_from(v3, source, reuse);
+            same = same && v3.size() == v1.size();
+        }
+    });
+    report("reused object", ms, bytes);
+    std::cout << (same && v1 == v3 ? "[true]\n" : "[false]\n");
+}
+
+struct MyStruct {
+    int a;
+    double b;
+    std::string c;
+
+    MyStruct() {}
+
+    MyStruct(int a1, double b1, std::string c1) : a(a1), b(b1), c(std::move(c1)) {}
+
+    auto get_all_member() -> decltype(auto) {
+        return std::make_tuple(a, b, c);
+    }
+
+    bool operator==(const MyStruct &rhs) const {
+        return a == rhs.a && b == rhs.b && c == rhs.c;
+    }
+};
+
+/**
+ * bench_batch - many small objects written and read with a file open per object versus through
+ * one binary::writer and binary::reader
+ */
+void bench_batch() {
+    const int n = 100000;
+    std::vector<MyStruct> v1;
+    for (int i = 0; i < n; i++) {
+        v1.emplace_back(i, i * 0.5, "struct " + std::to_string(i));
+    }
+    std::cout << n << " MyStruct objects:\n";
+    double ms = time_ms([&]() {
+        for (auto &s : v1) {
+            binary::serialize(s, "bench_batch_one.data");
+        }
+    });
+    std::cout << "  binary::serialize per object: " << ms << " ms\n";
+    MyStruct last;
+    ms = time_ms([&]() {
+        for (int i = 0; i < n; i++) {
+            binary::deserialize(last, "bench_batch_one.data");
+        }
+    });
+    std::cout << "  binary::deserialize per object: " << ms << " ms\n";
+
+    ms = time_ms([&]() {
+        binary::writer writer("bench_batch.data");
+        for (auto &s : v1) {
+            writer.write(s);
+        }
+    });
+    std::cout << "  binary::writer: " << ms << " ms\n";
+    std::vector<MyStruct> v2(n);
+    ms = time_ms([&]() {
+        binary::reader reader("bench_batch.data");
+        for (auto &s : v2) {
+            reader.read(s);
+        }
+    });
+    std::cout << "  binary::reader: " << ms << " ms\n";
+    std::cout << (last == v1.back() && v1 == v2 ? "[true]\n" : "[false]\n");
+}
+
+/**
+ * bench_size - serialization into a growing buffer versus into one sized by serialized_size
+ */
+void bench_size() {
+    const int n = 200000;
+    std::vector<Record> v1(n);
+    for (int i = 0; i < n; i++) {
+        v1[i] = Record{i, 1700000000ll + i, i * 0.5, "tag" + std::to_string(i % 100), std::vector<int>(i % 16, i)};
+    }
+    std::cout << "std::vector<Record> with " << n << " records:\n";
+    std::vector<char> buf1;
+    double ms = time_ms([&]() {
+        stream::memory_sink sink(buf1);
+        binary::serialize_to(v1, sink);
+    });
+    report("growing buffer", ms, buf1.size());
+
+    std::vector<char> buf2;
+    size_t size = 0;
+    double size_ms = time_ms([&]() { size = binary::serialized_size(v1); });
+    ms = time_ms([&]() {
+        stream::memory_sink sink(buf2);
+        sink.reserve(size);
+        binary::serialize_to(v1, sink);
+    });
+    report("serialized_size pass", size_ms, size);
+    report("presized buffer", ms, buf2.size());
+    std::cout << (buf1 == buf2 && buf2.capacity() == size ? "[true]\n" : "[false]\n");
+}
+
+/**
+ * bench_blocks - compress the serialized bytes of val with the block stage and decompress them
+ */
+template <typename T>
+void bench_blocks(const std::string &name, T &val) {
+    std::vector<char> plain;
+    stream::memory_sink plain_sink(plain);
+    binary::serialize_to(val, plain_sink);
+
+    std::vector<char> packed;
+    double ms = time_ms([&]() {
+        stream::memory_sink sink(packed);
+        compress::block_sink<stream::memory_sink> blocks(sink);
+        blocks.write(plain.data(), plain.size());
+        blocks.finish();
+    });
+    std::cout << "  " << name << ": " << plain.size() << " -> " << packed.size() << " bytes, ratio "
+              << static_cast<double>(plain.size()) / packed.size() << "\n";
+    report("    compress", ms, plain.size());
+
+    std::vector<char> unpacked(plain.size());
+    ms = time_ms([&]() {
+        stream::memory_source source(packed);
+        compress::block_source<stream::memory_source> blocks(source);
+        blocks.read(unpacked.data(), unpacked.size());
+        blocks.finish();
+    });
+    report("    decompress", ms, plain.size());
+    std::cout << (unpacked == plain ? "[true]\n" : "[false]\n");
+}
+
+void bench_compress() {
+    std::mt19937_64 rng(42);
+    std::vector<MyStruct> structs;
+    for (int i = 0; i < 1000000; i++) {
+        structs.emplace_back(static_cast<int>(rng() % 1000), (rng() % 64) * 0.25, "struct " + std::to_string(rng() % 32));
+    }
+    std::vector<double> smooth(4 << 20);
+    for (size_t i = 0; i < smooth.size(); i++) {
+        smooth[i] = 20.0 + static_cast<int>(i / 64 % 100) * 0.5;
+    }
+    std::map<int, std::vector<int>> groups;
+    for (int i = 0; i < 100000; i++) {
+        groups[i] = std::vector<int>(rng() % 16, static_cast<int>(rng() % 100));
+    }
+    std::vector<double> noise(4 << 20);
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    for (auto &d : noise) {
+        d = dist(rng);
+    }
+    std::cout << "block compression with " << compress::default_block_size << " byte blocks:\n";
+    bench_blocks("std::vector<MyStruct>", structs);
+    bench_blocks("std::vector<double> of repeated readings", smooth);
+    bench_blocks("std::map<int, std::vector<int>>", groups);
+    bench_blocks("std::vector<double> of random values", noise);
+}
+
+/**
+ * bench_parallel - serialize and deserialize through the block stage with 1 to N threads, to a
+ * memory buffer where the compression is all the work and to a file through writer and reader
+ */
+void bench_parallel() {
+    std::mt19937_64 rng(7);
+    std::vector<MyStruct> v1;
+    for (int i = 0; i < 2000000; i++) {
+        v1.emplace_back(static_cast<int>(rng() % 1000), (rng() % 64) * 0.25, "struct " + std::to_string(rng() % 32));
+    }
+    size_t bytes = binary::serialized_size(v1);
+    unsigned max_threads = std::max(4u, std::thread::hardware_concurrency());
+    std::cout << v1.size() << " MyStruct objects compressed, " << std::thread::hardware_concurrency()
+              << " hardware threads:\n";
+    bool ok = true;
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+        binary::options opts;
+        opts.compress = true;
+        opts.threads = threads;
+        std::cout << " " << threads << (threads == 1 ? " thread" : " threads") << ":\n";
+        std::vector<char> buf;
+        double ms = time_ms([&]() {
+            stream::memory_sink sink(buf);
+            binary::serialize_to(v1, sink, opts);
+        });
+        report("  serialize_to memory", ms, bytes);
+        std::vector<MyStruct> v2;
+        ms = time_ms([&]() {
+            stream::memory_source source(buf);
+            binary::deserialize_from(v2, source, opts);
+        });
+        report("  deserialize_from memory", ms, bytes);
+        ms = time_ms([&]() {
+            binary::writer writer("bench_parallel.data", opts);
+            writer.write(v1);
+        });
+        report("  writer", ms, bytes);
+        std::vector<MyStruct> v3;
+        ms = time_ms([&]() {
+            binary::reader reader("bench_parallel.data", opts);
+            reader.read(v3);
+        });
+        report("  reader", ms, bytes);
+        ok = ok && v2 == v1 && v3 == v1;
+    }
+    std::cout << (ok ? "[true]\n" : "[false]\n");
+}
+
+/**
+ * bench_encode - serialize val to memory and through a writer, and deserialize it from memory, with
+ * the options opts
+ */
+template <typename T>
+void bench_encode(T &val, const binary::options &opts, size_t bytes) {
+    std::vector<char> buf;
+    buf.reserve(2 * bytes);
+    double ms = best_ms(3, [&]() {
+        buf.clear();
+        stream::memory_sink sink(buf);
+        binary::serialize_to(val, sink, opts);
+    });
+    report("serialize_to memory", ms, bytes);
+    ms = best_ms(3, [&]() {
+        binary::writer writer("bench_checksum.data", opts);
+        writer.write(val);
+    });
+    report("writer", ms, bytes);
+    T val2;
+    ms = best_ms(3, [&]() {
+        stream::memory_source source(buf);
+        binary::deserialize_from(val2, source, opts);
+    });
+    report("deserialize_from memory", ms, bytes);
+}
+
+/**
+ * bench_checksum - the CRC32C kernels, and the cost of the checksummed block stage against
+ * plain serialization
+ */
+void bench_checksum() {
+    std::vector<char> data(64 << 20);
+    std::mt19937_64 rng(3);
+    for (auto &c : data) {
+        c = static_cast<char>(rng());
+    }
+    uint32_t crc = 0;
+    double ms = time_ms([&]() {
+        crc ^= ~checksum::crc32c_scalar(~0u, data.data(), data.size());
+    });
+    std::cout << "CRC32C of " << data.size() << " bytes:\n";
+    report("table", ms, data.size());
+    ms = time_ms([&]() {
+        crc ^= checksum::crc32c(data.data(), data.size());
+    });
+    report("selected kernel", ms, data.size());
+    std::cout << (crc == 0 ? "[true]\n" : "[false]\n");
+
+    std::vector<MyStruct> structs;
+    for (int i = 0; i < 1000000; i++) {
+        structs.emplace_back(static_cast<int>(rng() % 1000), (rng() % 64) * 0.25, "struct " + std::to_string(rng() % 32));
+    }
+    std::vector<double> doubles(4 << 20);
+    for (auto &d : doubles) {
+        d = static_cast<double>(rng() % 100000) / 7;
+    }
+    binary::options plain, checked;
+    checked.checksum = true;
+    for (int round = 0; round < 2; round++) {
+        std::cout << "std::vector<MyStruct>, " << (round == 0 ? "plain" : "checksummed") << ":\n";
+        bench_encode(structs, round == 0 ? plain : checked, binary::serialized_size(structs));
+    }
+    for (int round = 0; round < 2; round++) {
+        std::cout << "std::vector<double>, " << (round == 0 ? "plain" : "checksummed") << ":\n";
+        bench_encode(doubles, round == 0 ? plain : checked, binary::serialized_size(doubles));
+    }
+}
+
+/**
+ * bench_order - serialize val in the host's byte order and in the other one
+ */
+template <typename T>
+void bench_order(const std::string &name, T &val) {
+    size_t bytes = binary::serialized_size(val);
+    bool host_little = std::endian::native == std::endian::little;
+    binary::options orders[2];
+    orders[0].order = host_little ? binary::byte_order::little : binary::byte_order::big;
+    orders[1].order = host_little ? binary::byte_order::big : binary::byte_order::little;
+    std::cout << name << ":\n";
+    bool ok = true;
+    for (int i = 0; i < 2; i++) {
+        const binary::options &opts = orders[i];
+        std::string order = i == 0 ? "host order" : "swapped";
+        std::vector<char> buf;
+        buf.reserve(bytes);
+        double ms = best_ms(3, [&]() {
+            buf.clear();
+            stream::memory_sink sink(buf);
+            binary::serialize_to(val, sink, opts);
+        });
+        report("serialize_to, " + order, ms, bytes);
+        T val2;
+        ms = best_ms(3, [&]() {
+            stream::memory_source source(buf);
+            binary::deserialize_from(val2, source, opts);
+        });
+        report("deserialize_from, " + order, ms, bytes);
+        ok = ok && val2 == val;
+    }
+    std::cout << (ok ? "[true]\n" : "[false]\n");
+}
+
+/**
+ * bench_endian - the byte swapping kernels, and serialization in a fixed byte order
+ */
+void bench_endian() {
+    std::vector<char> in(64 << 20), out(64 << 20);
+    std::mt19937_64 rng(5);
+    for (auto &c : in) {
+        c = static_cast<char>(rng());
+    }
+    std::cout << "byte swapping " << in.size() << " bytes of 8-byte elements:\n";
+    double ms = best_ms(3, [&]() {
+        codec::byte_swap_scalar<8>(in.data(), in.size() / 8, out.data());
+    });
+    report("scalar", ms, in.size());
+    ms = best_ms(3, [&]() {
+        codec::byte_swap<8>(in.data(), in.size() / 8, out.data());
+    });
+    report("selected kernel", ms, in.size());
+    ms = best_ms(3, [&]() {
+        std::memcpy(out.data(), in.data(), in.size());
+    });
+    report("memcpy", ms, in.size());
+
+    std::vector<double> doubles(4 << 20);
+    for (auto &d : doubles) {
+        d = static_cast<double>(rng() % 100000) / 7;
+    }
+    std::vector<int16_t> shorts(16 << 20);
+    for (auto &v : shorts) {
+        v = static_cast<int16_t>(rng());
+    }
+    std::vector<MyStruct> structs;
+    for (int i = 0; i < 1000000; i++) {
+        structs.emplace_back(static_cast<int>(rng() % 1000), (rng() % 64) * 0.25, "struct " + std::to_string(rng() % 32));
+    }
+    bench_order("std::vector<double>", doubles);
+    bench_order("std::vector<int16_t>", shorts);
+    bench_order("std::vector<MyStruct>", structs);
+}
+
+template <typename T>
+void bench_graph(const std::string &name, T &val) {
+    std::vector<char> buf;
+    double ms = best_ms(3, [&]() {
+        buf.clear();
+        stream::memory_sink sink(buf);
+        binary::serialize_to(val, sink);
+    });
+    std::cout << name << ", " << buf.size() << " bytes:\n";
+    report("serialize_to", ms, buf.size());
+    T val2;
+    ms = best_ms(3, [&]() {
+        stream::memory_source source(buf);
+        binary::deserialize_from(val2, source);
+    });
+    report("deserialize_from", ms, buf.size());
+}
+
+/**
+ * bench_shared - 200000 entries pointing at a thousand shared configurations versus a copy in
+ * every entry, and the price of tracking identity when nothing is shared
+ */
+void bench_shared() {
+    std::vector<std::shared_ptr<MyStruct>> configs;
+    for (int i = 0; i < 1000; i++) {
+        configs.push_back(std::make_shared<MyStruct>(i, i * 0.5, std::string(200, 'a' + i % 26)));
+    }
+    std::vector<std::shared_ptr<MyStruct>> shared;
+    std::vector<MyStruct> copies;
+    for (int i = 0; i < 200000; i++) {
+        shared.push_back(configs[(i * 7919) % configs.size()]);
+        copies.push_back(*shared.back());
+    }
+    bench_graph("200000 std::shared_ptr to 1000 objects", shared);
+    bench_graph("200000 copies", copies);
+
+    std::vector<std::shared_ptr<MyStruct>> unshared;
+    std::vector<std::unique_ptr<MyStruct>> owned;
+    for (int i = 0; i < 200000; i++) {
+        unshared.push_back(std::make_shared<MyStruct>(i, i * 0.5, "struct"));
+        owned.push_back(std::make_unique<MyStruct>(i, i * 0.5, "struct"));
+    }
+    bench_graph("200000 std::shared_ptr to distinct objects", unshared);
+    bench_graph("200000 std::unique_ptr", owned);
+}
+
+template <typename T>
+void bench_columns(const std::string &name, std::vector<T> &val) {
+    std::cout << name << " of " << val.size() << " elements:\n";
+    bool ok = true;
+    for (int format = 0; format < 3; format++) {
+        for (int columnar = 0; columnar < 2; columnar++) {
+            binary::options opts;
+            opts.compact = format > 0;
+            opts.compress = format > 1;
+            opts.columnar = columnar;
+            std::string label = std::string(columnar ? "columns" : "rows") + (format == 0 ? "" : format == 1 ? ", compact" : ", compact and compressed");
+            std::vector<char> buf;
+            double ms = best_ms(3, [&]() {
+                buf.clear();
+                stream::memory_sink sink(buf);
+                binary::serialize_to(val, sink, opts);
+            });
+            std::cout << "  " << label << ", " << buf.size() << " bytes:\n";
+            report("serialize_to", ms, buf.size());
+            std::vector<T> val2;
+            ms = best_ms(3, [&]() {
+                stream::memory_source source(buf);
+                binary::deserialize_from(val2, source, opts);
+            });
+            report("deserialize_from", ms, buf.size());
+            ok = ok && val2 == val;
+            if (columnar) {
+                opts.column_mask = 0b010;
+                ms = best_ms(3, [&]() {
+                    stream::memory_source source(buf);
+                    binary::deserialize_from(val2, source, opts);
+                });
+                report("deserialize_from, the second column only", ms, buf.size());
+            }
+        }
+    }
+    std::cout << (ok ? "[true]\n" : "[false]\n");
+}
+
+/**
+ * bench_columnar - vectors of user types written in rows versus in columns, in the fixed, the
+ * compact and the compressed format, and one column read on its own
+ */
+void bench_columnar() {
+    std::mt19937_64 rng(11);
+    std::vector<Sample> samples(1000000);
+    double value = 20;
+    for (size_t i = 0; i < samples.size(); i++) {
+        value += static_cast<double>(rng() % 9) * 0.125 - 0.5;
+        samples[i] = {static_cast<int>(rng() % 16), value, 1700000000000ll + static_cast<long long>(i) * 250,
+                      value - 1, value + 1};
+    }
+    std::vector<MyStruct> structs;
+    for (int i = 0; i < 1000000; i++) {
+        structs.emplace_back(i * 8 + static_cast<int>(rng() % 8), (rng() % 4096) * 0.25, "sensor " + std::to_string(rng() % 64));
+    }
+    bench_columns("std::vector<Sample>", samples);
+    bench_columns("std::vector<MyStruct>", structs);
+}
+
+/**
+ * bench_ascending - the keys of a std::set<int> in the compact format, as the stream VByte of
+ * the previous format and as bit-packed gaps, decoded alone and into the set
+ */
+void bench_ascending() {
+    std::mt19937_64 rng(13);
+    std::set<int> ids;
+    for (int id = 0; ids.size() < 1000000; id += 1 + static_cast<int>(rng() % 16)) {
+        ids.insert(ids.end(), id);
+    }
+    binary::options opts;
+    opts.compact = true;
+    stream::counting_sink counter;
+    binary::encoder<stream::counting_sink> counting(counter, opts);
+    detail::write_packed<int>(ids.begin(), ids.size(), counting);
+    std::vector<char> packed_buf;
+    stream::memory_sink packed_sink(packed_buf);
+    binary::encoder<stream::memory_sink> packed_enc(packed_sink, opts);
+    double ms = best_ms(3, [&]() {
+        packed_buf.clear();
+        detail::write_packed<int>(ids.begin(), ids.size(), packed_enc);
+    });
+    std::cout << "std::set<int> of " << ids.size() << " ids with gaps up to 16:\n";
+    std::cout << "  stream VByte, " << packed_buf.size() << " bytes:\n";
+    report("write", ms, packed_buf.size());
+    std::vector<int> decoded;
+    decoded.reserve(ids.size());
+    ms = best_ms(3, [&]() {
+        decoded.clear();
+        stream::memory_source source(packed_buf);
+        detail::read_packed<int>(ids.size(), source, [&decoded](const uint32_t *values, size_t m) {
+            for (size_t i = 0; i < m; i++) {
+                decoded.push_back(detail::from_varint<int>(values[i]));
+            }
+        });
+    });
+    report("decode into a std::vector", ms, packed_buf.size());
+    std::set<int> ids2;
+    ms = best_ms(3, [&]() {
+        ids2.clear();
+        stream::memory_source source(packed_buf);
+        binary::decoder<stream::memory_source> packed_dec(source, opts);
+        detail::read_sequence<int>(ids.size(), packed_dec, [&ids2](int &&value) {
+            ids2.emplace_hint(ids2.end(), value);
+        });
+    });
+    report("decode into the std::set", ms, packed_buf.size());
+    bool ok = ids2 == ids;
+
+    std::vector<char> gap_buf;
+    ms = best_ms(3, [&]() {
+        gap_buf.clear();
+        stream::memory_sink sink(gap_buf);
+        binary::serialize_to(ids, sink, opts);
+    });
+    std::cout << "  bit-packed gaps, " << gap_buf.size() << " bytes:\n";
+    report("serialize_to", ms, gap_buf.size());
+    ms = best_ms(3, [&]() {
+        decoded.clear();
+        stream::memory_source source(gap_buf);
+        binary::decoder<stream::memory_source> gap_dec(source, opts);
+        detail::read_ascending<int>(detail::read_size(gap_dec), gap_dec, [&decoded](const int *values, size_t m) {
+            decoded.insert(decoded.end(), values, values + m);
+        });
+    });
+    report("decode into a std::vector", ms, gap_buf.size());
+    ms = best_ms(3, [&]() {
+        stream::memory_source source(gap_buf);
+        binary::deserialize_from(ids2, source, opts);
+    });
+    report("deserialize_from into the std::set", ms, gap_buf.size());
+    opts.reuse = true;
+    ms = best_ms(3, [&]() {
+        stream::memory_source source(gap_buf);
+        binary::deserialize_from(ids2, source, opts);
+    });
+    report("deserialize_from, reusing the nodes", ms, gap_buf.size());
+    ok = ok && ids2 == ids && std::equal(decoded.begin(), decoded.end(), ids.begin(), ids.end());
+    std::cout << (ok ? "[true]\n" : "[false]\n");
+}
+
+/**
+ * bench_series - a std::vector<double> written as raw numbers, compressed by the LZ blocks and
+ * by the XOR codec, with the throughput of the raw bytes
+ */
+void bench_series(const std::string &name, std::vector<double> &series) {
+    binary::options formats[3];
+    formats[1].compress = true;
+    formats[2].xor_floats = true;
+    const char *format_names[] = {"raw", "LZ blocks", "XOR"};
+    size_t bytes = series.size() * sizeof(double);
+    std::cout << name << " of " << series.size() << " doubles:\n";
+    bool ok = true;
+    for (int f = 0; f < 3; f++) {
+        std::vector<char> buf;
+        double ms = best_ms(3, [&]() {
+            buf.clear();
+            stream::memory_sink sink(buf);
+            binary::serialize_to(series, sink, formats[f]);
+        });
+        std::cout << "  " << format_names[f] << ", " << buf.size() << " bytes, "
+                  << static_cast<double>(bytes) / buf.size() << "x:\n";
+        report("serialize_to", ms, bytes);
+        std::vector<double> series2;
+        ms = best_ms(3, [&]() {
+            stream::memory_source source(buf);
+            binary::deserialize_from(series2, source, formats[f]);
+        });
+        report("deserialize_from", ms, bytes);
+        ok = ok && series2 == series;
+    }
+    std::cout << (ok ? "[true]\n" : "[false]\n");
+}
+
+void bench_xor() {
+    const int n = 1000000;
+    std::mt19937_64 rng(21);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    std::vector<double> smooth(n), ticks(n), noisy(n);
+    double price = 100.0;
+    for (int i = 0; i < n; i++) {
+        // a sensor sampled faster than it changes, a price moving by whole cents and plain noise
+        smooth[i] = 20.0 + 0.5 * (i / 64 % 32);
+        price = std::max(1.0, price + (static_cast<int>(rng() % 5) - 2) * 0.01);
+        ticks[i] = std::round(price * 100) / 100;
+        noisy[i] = noise(rng);
+    }
+    bench_series("a smooth series", smooth);
+    bench_series("a series of prices", ticks);
+    bench_series("a noisy series", noisy);
+}
+
+struct UserDefinedType {
+    int idx;
+    std::string name;
+    std::vector<double> data;
+
+    UserDefinedType() {}
+
+    UserDefinedType(int i, std::string n, std::vector<double> d) : idx(i), name(std::move(n)), data(std::move(d)) {}
+
+    auto get_all_member() -> decltype(auto) {
+        return std::make_tuple(idx, name, data);
+    }
+
+    bool operator==(const UserDefinedType &rhs) const {
+        return idx == rhs.idx && name == rhs.name && data == rhs.data;
+    }
+};
+
+/**
+ * bench_dictionary - records with a few repeated names longer than the small string buffer,
+ * written whole and through the dictionary of strings, and the names alone read as views
+ */
+void bench_dictionary() {
+    const int n = 200000;
+    std::vector<UserDefinedType> v1;
+    std::vector<std::string> names;
+    for (int i = 0; i < n; i++) {
+        std::string name = "backend-" + std::to_string(i % 50) + ".eu-west-1.compute.internal";
+        v1.emplace_back(i, name, std::vector<double>{i * 0.5});
+        names.push_back(std::move(name));
+    }
+    std::cout << "std::vector<UserDefinedType> of " << n << " records with 50 names:\n";
+    bool ok = true;
+    for (bool dictionary : {false, true}) {
+        binary::options opts;
+        opts.compact = true;
+        opts.string_dictionary = dictionary;
+        std::vector<char> buf;
+        double ms = best_ms(3, [&]() {
+            buf.clear();
+            stream::memory_sink sink(buf);
+            binary::serialize_to(v1, sink, opts);
+        });
+        std::cout << "  " << (dictionary ? "dictionary" : "whole strings") << ", " << buf.size() << " bytes:\n";
+        report("serialize_to", ms, buf.size());
+        std::vector<UserDefinedType> v2;
+        ms = best_ms(3, [&]() {
+            v2.clear();
+            v2.shrink_to_fit();
+            stream::memory_source source(buf);
+            binary::deserialize_from(v2, source, opts);
+        });
+        report("deserialize_from", ms, buf.size());
+        opts.reuse = true;
+        ms = best_ms(3, [&]() {
+            stream::memory_source source(buf);
+            binary::deserialize_from(v2, source, opts);
+        });
+        report("deserialize_from, reusing the strings", ms, buf.size());
+        ok = ok && v2 == v1;
+
+        opts.reuse = false;
+        std::vector<char> names_buf;
+        stream::memory_sink names_sink(names_buf);
+        binary::serialize_to(names, names_sink, opts);
+        std::vector<std::string_view> views;
+        ms = best_ms(3, [&]() {
+            stream::memory_source source(names_buf);
+            binary::deserialize_from(views, source, opts);
+        });
+        report("the names as std::string_view", ms, names_buf.size());
+        ok = ok && std::equal(views.begin(), views.end(), names.begin(), names.end());
+    }
+    std::cout << (ok ? "[true]\n" : "[false]\n");
+}
+
+/**
+ * bench_front - an index of paths as a std::set<std::string> in the compact format, with the keys
+ * written whole like the previous format and front coded, and looked up through the view
+ */
+void bench_front() {
+    const int n = 1000000;
+    std::mt19937_64 rng(25);
+    std::set<std::string> index;
+    while (static_cast<int>(index.size()) < n) {
+        index.insert("/data/tenant-" + std::to_string(rng() % 40) + "/objects/" + std::to_string(rng() % 100000000) + ".bin");
+    }
+    binary::options opts;
+    opts.compact = true;
+    std::cout << "std::set<std::string> of " << n << " paths:\n";
+
+    std::vector<char> whole_buf;
+    stream::memory_sink whole_sink(whole_buf);
+    binary::encoder<stream::memory_sink> whole_enc(whole_sink, opts);
+    detail::write_size(index.size(), whole_enc);
+    for (const std::string &key : index) {
+        binary::serialize_helper(key, whole_enc);
+    }
+    std::set<std::string> index2;
+    double ms = best_ms(3, [&]() {
+        index2.clear();
+        stream::memory_source source(whole_buf);
+        binary::decoder<stream::memory_source> dec(source, opts);
+        size_t size = detail::read_size(dec);
+        detail::read_sequence<std::string>(size, dec, [&index2](std::string &&key) {
+            index2.emplace_hint(index2.end(), std::move(key));
+        });
+    });
+    std::cout << "  whole keys, " << whole_buf.size() << " bytes:\n";
+    report("load", ms, whole_buf.size());
+    bool ok = index2 == index;
+
+    std::vector<char> front_buf;
+    ms = best_ms(3, [&]() {
+        front_buf.clear();
+        stream::memory_sink sink(front_buf);
+        binary::serialize_to(index, sink, opts);
+    });
+    std::cout << "  front coded, " << front_buf.size() << " bytes:\n";
+    report("serialize_to", ms, front_buf.size());
+    ms = best_ms(3, [&]() {
+        stream::memory_source source(front_buf);
+        binary::deserialize_from(index2, source, opts);
+    });
+    report("load", ms, front_buf.size());
+    ok = ok && index2 == index;
+
+    std::vector<std::string> probes;
+    for (auto it = index.begin(); probes.size() < 100000; std::advance(it, n / 100000)) {
+        probes.push_back(*it);
+        probes.push_back(*it + "x");
+    }
+    binary::front_coded_keys view;
+    size_t found = 0;
+    ms = best_ms(3, [&]() {
+        stream::memory_source source(front_buf);
+        binary::deserialize_from(view, source, opts);
+        found = 0;
+        for (const std::string &probe : probes) {
+            found += view.contains(probe);
+        }
+    });
+    std::cout << "  " << probes.size() << " lookups through front_coded_keys without loading: " << ms << " ms\n";
+    ok = ok && found == probes.size() / 2;
+    std::cout << (ok ? "[true]\n" : "[false]\n");
+}
+
+int main(int argc, char **argv) {
+    if (selected(argc, argv, "bulk")) {
+        bench_bulk();
+    }
+    if (selected(argc, argv, "string")) {
+        bench_string();
+    }
+    if (selected(argc, argv, "compact")) {
+        bench_compact();
+    }
+    if (selected(argc, argv, "packed")) {
+        bench_packed();
+    }
+    if (selected(argc, argv, "mmap")) {
+        bench_mmap();
+    }
+    if (selected(argc, argv, "views")) {
+        bench_views();
+    }
+    if (selected(argc, argv, "trivial")) {
+        bench_trivial();
+    }
+    if (selected(argc, argv, "presized")) {
+        bench_presized();
+    }
+    if (selected(argc, argv, "reuse")) {
+        bench_reuse();
+    }
+    if (selected(argc, argv, "batch")) {
+        bench_batch();
+    }
+    if (selected(argc, argv, "size")) {
+        bench_size();
+    }
+    if (selected(argc, argv, "compress")) {
+        bench_compress();
+    }
+    if (selected(argc, argv, "parallel")) {
+        bench_parallel();
+    }
+    if (selected(argc, argv, "checksum")) {
+        bench_checksum();
+    }
+    if (selected(argc, argv, "endian")) {
+        bench_endian();
+    }
+    if (selected(argc, argv, "shared")) {
+        bench_shared();
+    }
+    if (selected(argc, argv, "columnar")) {
+        bench_columnar();
+    }
+    if (selected(argc, argv, "ascending")) {
+        bench_ascending();
+    }
+    if (selected(argc, argv, "xor")) {
+        bench_xor();
+    }
+    if (selected(argc, argv, "dictionary")) {
+        bench_dictionary();
+    }
+    if (selected(argc, argv, "front")) {
+        bench_front();
+    }
+    return 0;
+}
\ No newline at end of file
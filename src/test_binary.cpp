@@ -1,6 +1,76 @@
 #include "../include/binary.h"
 #include <assert.h>
+#include <atomic>
+#include <climits>
+#include <cstdlib>
+#include <fcntl.h>
 #include <iostream>
+#include <new>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+
+// the number of heap allocations made by the program so far, the compressing threads count too.
+// Every form of new and delete is replaced so they pair up, and they stay out of line so the
+// compiler never matches the malloc of one against the free of another
+static std::atomic<size_t> allocation_count{0};
+// while set, the allocations of every thread but the main one fail, like worker threads out of memory
+static std::atomic<bool> fail_thread_allocations{false};
+static const std::thread::id main_thread_id = std::this_thread::get_id();
+
+static void *count_allocation(size_t size) noexcept {
+    if (fail_thread_allocations && std::this_thread::get_id() != main_thread_id) {
+        return nullptr;
+    }
+    allocation_count++;
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+[[gnu::noinline]] void *operator new(size_t size) {
+    if (void *p = count_allocation(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void *operator new[](size_t size) {
+    if (void *p = count_allocation(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    return count_allocation(size);
+}
+
+[[gnu::noinline]] void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+    return count_allocation(size);
+}
+
+[[gnu::noinline]] void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+[[gnu::noinline]] void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+[[gnu::noinline]] void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+[[gnu::noinline]] void operator delete[](void *p, size_t) noexcept {
+    std::free(p);
+}
+
+[[gnu::noinline]] void operator delete(void *p, const std::nothrow_t &) noexcept {
+    std::free(p);
+}
+
+[[gnu::noinline]] void operator delete[](void *p, const std::nothrow_t &) noexcept {
+    std::free(p);
+}
 
 struct MyStruct {
     int a;
@@ -38,6 +108,130 @@ bool operator==(const UserDefinedType &lhs, const UserDefinedType &rhs) {
     return lhs.idx == rhs.idx && lhs.name == rhs.name && lhs.data == rhs.data;
 }
 
+// TiedStruct exposes references to its members, which are serialized and deserialized in place
+struct TiedStruct {
+    int idx;
+    std::string name;
+    std::vector<double> data;
+
+    auto get_all_member() -> decltype(auto) {
+        return std::tie(idx, name, data);
+    }
+};
+
+bool operator==(const TiedStruct &lhs, const TiedStruct &rhs) {
+    return lhs.idx == rhs.idx && lhs.name == rhs.name && lhs.data == rhs.data;
+}
+
+// Message holds nested containers of strings, which are refilled in place by the reuse mode
+struct Message {
+    int id;
+    std::string topic;
+    std::vector<std::string> tags;
+    std::map<int, std::string> fields;
+    std::set<std::string> keys;
+    std::list<std::string> notes;
+    std::vector<double> values;
+
+    auto get_all_member() -> decltype(auto) {
+        return std::tie(id, topic, tags, fields, keys, notes, values);
+    }
+
+    bool operator==(const Message &rhs) const {
+        return id == rhs.id && topic == rhs.topic && tags == rhs.tags && fields == rhs.fields && keys == rhs.keys &&
+               notes == rhs.notes && values == rhs.values;
+    }
+};
+
+// Telemetry is a plain struct of numbers, which is opted in to be written as raw bytes
+struct Telemetry {
+    int sensor;
+    short channel;
+    double value;
+    long long timestamp;
+    float samples[4];
+
+    auto get_all_member() -> decltype(auto) {
+        return std::tie(sensor, channel, value, timestamp, samples);
+    }
+};
+
+template <>
+struct detail::is_trivially_serializable<Telemetry> : std::true_type {};
+
+bool operator==(const Telemetry &lhs, const Telemetry &rhs) {
+    return lhs.sensor == rhs.sensor && lhs.channel == rhs.channel && lhs.value == rhs.value &&
+           lhs.timestamp == rhs.timestamp && std::equal(lhs.samples, lhs.samples + 4, rhs.samples);
+}
+
+// the same size as Telemetry, but a different alignment
+struct PackedTelemetry {
+    char bytes[sizeof(Telemetry)];
+};
+
+template <>
+struct detail::is_trivially_serializable<PackedTelemetry> : std::true_type {};
+
+// TreeNode owns its children and points back to its parent, a cycle closed by a std::weak_ptr
+struct TreeNode {
+    std::string name;
+    std::weak_ptr<TreeNode> parent;
+    std::vector<std::shared_ptr<TreeNode>> children;
+
+    auto get_all_member() -> decltype(auto) {
+        return std::tie(name, parent, children);
+    }
+};
+
+// zero_source - a buffer source of serialized headers, each followed by a run of zero bytes that is
+// borrowed from a mapping of untouched pages, so views of gigabytes are read without the memory
+class zero_source {
+public:
+    zero_source(std::vector<std::pair<std::vector<char>, size_t>> parts, const char *zeros)
+        : parts_(std::move(parts)), zeros_(zeros), part_(0), pos_(0) {}
+
+    void read(char *data, size_t n) {
+        while (n > 0) {
+            size_t m = 0;
+            const char *p = next(n, m);
+            std::memcpy(data, p, m);
+            data += m;
+            n -= m;
+        }
+    }
+
+    const char *borrow(size_t n) {
+        size_t m = 0;
+        const char *p = n == 0 ? zeros_ : next(n, m);
+        if (m != n) {
+            throw std::out_of_range("zero_source: borrow across a header");
+        }
+        return p;
+    }
+
+private:
+    // next - skip up to n bytes of the current header or zero run and return a pointer to them
+    const char *next(size_t n, size_t &m) {
+        while (part_ < parts_.size() && pos_ == parts_[part_].first.size() + parts_[part_].second) {
+            part_++;
+            pos_ = 0;
+        }
+        if (part_ == parts_.size()) {
+            throw std::out_of_range("zero_source: read past the end");
+        }
+        const auto &[header, zeros] = parts_[part_];
+        const char *p = pos_ < header.size() ? header.data() + pos_ : zeros_;
+        m = std::min(n, pos_ < header.size() ? header.size() - pos_ : header.size() + zeros - pos_);
+        pos_ += m;
+        return p;
+    }
+
+    std::vector<std::pair<std::vector<char>, size_t>> parts_;
+    const char *zeros_;
+    size_t part_;
+    size_t pos_;
+};
+
 /**
  * test_arithmetic - test the serialization and deserialization of arithmetic types,
  * like int, double, short, etc.
@@ -116,6 +310,18 @@ int main() {
         std::cout << "[false]\n";
     }
 
+    std::cout << "Test for serializing std::string with embedded zero bytes: \n";
+    std::string s3("Hello\0world\0", 12), s4;
+    s3 += std::string(1 << 20, 'x');
+    binary::serialize(s3, "s0.data");
+    binary::deserialize(s4, "s0.data");
+    std::cout << "Serialize: " << s3.size() << " bytes" << std::endl << "Deserialize: " << s4.size() << " bytes" << std::endl;
+    if (s3 == s4) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
     std::cout << "Test for serializing std::vector<int>: \n";
     test_stl(std::vector<int>{1, 2, 3, 4, 5}, "v.data");
 
@@ -174,6 +380,9 @@ int main() {
         std::cout << "[false]\n";
     }
 
+    std::cout << "Test for serializing std::vector<double>: \n";
+    test_stl(std::vector<double>{1.5, 2.5, 3.5, 4.5, 5.5}, "vd.data");
+
     std::vector<int> v1{1, 2, 3, 4, 5};
 
     std::cout << "Test for serializing std::vector<std::vector<int>>: \n";
@@ -279,6 +488,964 @@ int main() {
         std::cout << "[false]\n";
     }
 
+    std::cout << "Test for serializing MyStruct into memory: \n";
+    std::vector<char> buf;
+    stream::memory_sink msink(buf);
+    binary::serialize_to(struct1, msink);
+    stream::memory_source msource(buf);
+    MyStruct struct3;
+    binary::deserialize_from(struct3, msource);
+    std::cout << "Serialize: " << struct1.a << " " << struct1.b << " " << struct1.c << std::endl;
+    std::cout << "Deserialize: " << struct3.a << " " << struct3.b << " " << struct3.c << std::endl;
+    if (struct1 == struct3 && msource.position() == buf.size()) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for serializing std::vector<MyStruct> in the compact format: \n";
+    binary::options compact;
+    compact.compact = true;
+    std::vector<MyStruct> vs3{{-3, 1.5, "compact"}, {1 << 20, 2.5, ""}, {-(1 << 30), -0.5, "format"}}, vs4;
+    binary::serialize(vs3, "vsc.data", compact);
+    binary::deserialize(vs4, "vsc.data", compact);
+    std::cout << "Serialize: " << vs3.size() << " elements" << std::endl;
+    std::cout << "Deserialize: " << vs4.size() << " elements" << std::endl;
+    if (vs3 == vs4) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for serializing std::map<long long, std::vector<int>> in the compact format: \n";
+    std::map<long long, std::vector<int>> mc1{{-1, {1, -2, 300}}, {1ll << 40, {}}, {LLONG_MIN, {INT_MIN, INT_MAX}}}, mc2;
+    buf.clear();
+    binary::serialize_to(mc1, msink, compact);
+    stream::memory_source csource(buf);
+    binary::deserialize_from(mc2, csource, compact);
+    std::cout << "Serialize: " << mc1.size() << " entries in " << buf.size() << " bytes" << std::endl;
+    std::cout << "Deserialize: " << mc2.size() << " entries" << std::endl;
+    if (mc1 == mc2 && csource.position() == buf.size()) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for serializing integer containers in the compact format: \n";
+    std::vector<int> ic1(5000);
+    std::set<int> ic2;
+    std::list<short> ic3;
+    std::vector<unsigned long long> ic4(3001);
+    for (int i = 0; i < 5000; i++) {
+        ic1[i] = (i % 7 == 0 ? -1 : 1) * static_cast<int>(1ll * i * i * 97 % 100000007);
+        ic2.insert(i * 31 - 7000);
+        ic3.push_back(static_cast<short>(i * 13));
+    }
+    for (int i = 0; i < 3001; i++) {
+        ic4[i] = 1ull << (i % 64);
+    }
+    std::tuple<std::vector<int>, std::set<int>, std::list<short>, std::vector<unsigned long long>> ict1{ic1, ic2, ic3, ic4}, ict2;
+    binary::serialize(ict1, "ic.data", compact);
+    binary::deserialize(ict2, "ic.data", compact);
+    std::cout << "Serialize: " << ic1.size() + ic2.size() + ic3.size() + ic4.size() << " integers" << std::endl;
+    std::cout << "Deserialize: " << std::get<0>(ict2).size() + std::get<1>(ict2).size() + std::get<2>(ict2).size() +
+                                      std::get<3>(ict2).size() << " integers" << std::endl;
+    if (ict1 == ict2) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for the stream VByte decoder of this CPU: \n";
+    std::vector<uint32_t> svb1(999), svb2(999 + codec::svb_padding), svb3(999 + codec::svb_padding);
+    for (size_t i = 0; i < svb1.size(); i++) {
+        svb1[i] = static_cast<uint32_t>(i * 2654435761u) >> (i % 32);
+    }
+    std::vector<uint8_t> control(codec::svb_control_size(svb1.size())), data(svb1.size() * 4 + codec::svb_padding);
+    size_t svb_len = codec::svb_encode32(svb1.data(), svb1.size(), control.data(), data.data());
+    codec::svb_decode32_scalar(control.data(), data.data(), svb1.size(), svb2.data());
+    codec::svb_decode32(control.data(), data.data(), svb1.size(), svb3.data());
+    svb2.resize(svb1.size());
+    svb3.resize(svb1.size());
+    // 64-bit integers of every length, the decoder of this CPU against the scalar one
+    std::vector<uint64_t> svb64(999), svb64_2(999 + codec::svb_padding), svb64_3(999 + codec::svb_padding);
+    for (size_t i = 0; i < svb64.size(); i++) {
+        svb64[i] = (i * 0x9e3779b97f4a7c15ull) >> (i % 64);
+    }
+    std::vector<uint8_t> control64(codec::svb_control_size(svb64.size())), data64(svb64.size() * 8 + codec::svb_padding);
+    size_t svb_len64 = codec::svb_encode64(svb64.data(), svb64.size(), control64.data(), data64.data());
+    codec::svb_decode64_scalar(control64.data(), data64.data(), svb64.size(), svb64_2.data());
+    codec::svb_decode64(control64.data(), data64.data(), svb64.size(), svb64_3.data());
+    svb64_2.resize(svb64.size());
+    svb64_3.resize(svb64.size());
+    bool ssse3_ok = true;
+#ifdef CODEC_X86_KERNELS
+    // the dispatch takes AVX2 over SSSE3, which is checked on its own
+    if (__builtin_cpu_supports("ssse3")) {
+        std::vector<uint64_t> svb64_4(svb64.size() + codec::svb_padding);
+        codec::svb_decode64_ssse3(control64.data(), data64.data(), svb64.size(), svb64_4.data());
+        svb64_4.resize(svb64.size());
+        ssse3_ok = svb64 == svb64_4;
+    }
+#endif
+    std::cout << "Encode: " << svb1.size() << " integers in " << svb_len << " bytes, " << svb64.size()
+              << " 64-bit ones in " << svb_len64 << " bytes" << std::endl;
+    if (svb1 == svb2 && svb1 == svb3 && codec::svb_data_size32(control.data(), svb1.size()) == svb_len &&
+        svb64 == svb64_2 && svb64 == svb64_3 && ssse3_ok &&
+        codec::svb_data_size64(control64.data(), svb64.size()) == svb_len64) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for the sizes beyond 32 bits: \n";
+    // the sizes are written to a counting sink first, so the test needs no large buffers
+    const size_t sizes[] = {0, (1ull << 31) - 1, 1ull << 31, (1ull << 32) - 2, (1ull << 32) - 1, 1ull << 32, 5ull << 40};
+    bool sizes_ok = true;
+    for (auto fmt : {binary::options(), compact}) {
+        stream::counting_sink csink;
+        binary::encoder<stream::counting_sink> cenc(csink, fmt);
+        buf.clear();
+        binary::encoder<stream::memory_sink> menc(msink, fmt);
+        for (auto size : sizes) {
+            detail::write_size(size, cenc);
+            detail::write_size(size, menc);
+        }
+        stream::memory_source ssource(buf);
+        binary::decoder<stream::memory_source> sdec(ssource, fmt);
+        for (auto size : sizes) {
+            sizes_ok = sizes_ok && detail::read_size(sdec) == size;
+        }
+        sizes_ok = sizes_ok && csink.size() == buf.size() && ssource.position() == buf.size();
+        // 4 bytes below 2^32 - 1 and 12 bytes from it on
+        sizes_ok = sizes_ok && (fmt.compact || buf.size() == 4 * 4 + 3 * 12);
+        std::cout << (fmt.compact ? "Compact: " : "Fixed: ") << buf.size() << " bytes for " << std::size(sizes)
+                  << " sizes" << std::endl;
+    }
+    // the largest varint ends with a 1 in its 10th byte, longer ones or more bits in it are corrupt
+    const std::vector<char> varints[] = {
+        {'\xff', '\xff', '\xff', '\xff', '\xff', '\xff', '\xff', '\xff', '\xff', '\x01'},
+        {'\xff', '\xff', '\xff', '\xff', '\xff', '\xff', '\xff', '\xff', '\xff', '\x02'},
+        {'\x80', '\x80', '\x80', '\x80', '\x80', '\x80', '\x80', '\x80', '\x80', '\x80', '\x00'}};
+    for (size_t i = 0; i < std::size(varints); i++) {
+        stream::memory_source vsource(varints[i]);
+        uint64_t val = 0;
+        bool rejected = false;
+        try {
+            val = detail::read_varint(vsource);
+        } catch (const std::out_of_range &) {
+            rejected = true;
+        }
+        sizes_ok = sizes_ok && (i == 0 ? !rejected && val == UINT64_MAX : rejected);
+    }
+    // a string and a vector layout of more than 4 GiB, written from and read into views of a
+    // mapping whose pages are never touched, so neither side needs the memory for them
+    const size_t big = (1ull << 32) + 5;
+    void *mapped = mmap(nullptr, big, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapped != MAP_FAILED) {
+        const char *zeros = static_cast<const char *>(mapped);
+        std::tuple<std::string_view, std::span<const char>> big0{std::string_view(zeros, big),
+                                                                 std::span<const char>(zeros, big)};
+        for (auto fmt : {binary::options(), compact}) {
+            stream::counting_sink bsink;
+            binary::serialize_to(big0, bsink, fmt);
+            std::vector<char> header;
+            stream::memory_sink hsink(header);
+            binary::encoder<stream::memory_sink> henc(hsink, fmt);
+            detail::write_size(big, henc);
+            sizes_ok = sizes_ok && (fmt.compact || header.size() == 12) &&
+                       bsink.size() == 2 * (header.size() + big) && binary::serialized_size(big0, fmt) == bsink.size();
+            zero_source bsource({{header, big}, {header, big}}, zeros);
+            std::tuple<std::string_view, std::span<const char>> big1;
+            binary::deserialize_from(big1, bsource, fmt);
+            sizes_ok = sizes_ok && std::get<0>(big1).size() == big && std::get<1>(big1).size() == big;
+        }
+        munmap(mapped, big);
+    }
+    // containers whose 64-bit size is followed by 3 elements only run out of stream, where a size
+    // cut to 32 bits would have read the 3 elements and stopped
+    auto truncated = [&](auto val) {
+        std::vector<char> tbuf;
+        stream::memory_sink tsink(tbuf);
+        binary::encoder<stream::memory_sink> tenc(tsink, binary::options());
+        detail::write_size((1ull << 32) + 3, tenc);
+        std::vector<char> elements;
+        stream::memory_sink esink(elements);
+        binary::serialize_to(val, esink);
+        tbuf.insert(tbuf.end(), elements.begin() + 4, elements.end());
+        stream::memory_source tsource(tbuf);
+        decltype(val) out;
+        try {
+            binary::deserialize_from(out, tsource);
+        } catch (const std::out_of_range &) {
+            return true;
+        }
+        return false;
+    };
+    sizes_ok = sizes_ok && truncated(std::string("abc")) && truncated(std::vector<char>{'a', 'b', 'c'}) &&
+               truncated(std::list<int>{1, 2, 3}) && truncated(std::set<int>{1, 2, 3}) &&
+               truncated(std::map<int, int>{{1, 1}, {2, 2}, {3, 3}});
+    if (sizes_ok) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for the allocations of deserializing UserDefinedType: \n";
+    UserDefinedType u4{4, "a name longer than the small string buffer", {1.5, 2.5, 3.5, 4.5}}, u5;
+    buf.clear();
+    binary::serialize_to(u4, msink);
+    stream::memory_source usource(buf);
+    size_t allocations = allocation_count;
+    binary::deserialize_from(u5, usource);
+    allocations = allocation_count - allocations;
+    // one for the characters of name and one for the elements of data
+    std::cout << "Allocations: " << allocations << std::endl;
+    if (u4 == u5 && allocations == 2) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for allocating large containers once from a buffer: \n";
+    // the sizes pass max_prealloc, which a buffer allows since its bytes left bound them
+    std::string large_s(40 << 20, 'l');
+    std::vector<std::string> large_vs(1 << 20);
+    std::vector<Telemetry> large_tm(1 << 20, Telemetry{1, 2, 3.5, 4, {5, 6, 7, 8}});
+    std::vector<char> large_buf;
+    stream::memory_sink large_sink(large_buf);
+    binary::serialize_to(std::tie(large_s, large_vs, large_tm), large_sink);
+    std::string large_s1;
+    std::vector<std::string> large_vs1;
+    std::vector<Telemetry> large_tm1;
+    stream::memory_source large_source(large_buf);
+    binary::decoder<stream::memory_source> large_dec(large_source, binary::options());
+    size_t large_allocations[3];
+    size_t large_before = allocation_count;
+    binary::deserialize_helper(large_s1, large_dec);
+    large_allocations[0] = allocation_count - large_before;
+    large_before = allocation_count;
+    binary::deserialize_helper(large_vs1, large_dec);
+    large_allocations[1] = allocation_count - large_before;
+    large_before = allocation_count;
+    binary::deserialize_helper(large_tm1, large_dec);
+    large_allocations[2] = allocation_count - large_before;
+    std::cout << "Allocations: " << large_allocations[0] << ", " << large_allocations[1] << " and "
+              << large_allocations[2] << std::endl;
+    bool large_ok = large_s1 == large_s && large_s1.capacity() == large_s.size() && large_vs1 == large_vs &&
+                    large_vs1.capacity() == large_vs.size() && large_tm1.size() == large_tm.size() &&
+                    large_tm1.capacity() == large_tm.size() && large_tm1.front().sensor == 1 &&
+                    large_tm1.back().samples[3] == 8;
+    // vectors of numbers raw, in the compact format and XOR compressed are read with one allocation
+    std::vector<double> large_d(3 << 20, 0.25);
+    std::vector<long long> large_ll(3 << 20, 1ll << 40);
+    binary::options large_xor;
+    large_xor.xor_floats = true;
+    for (const auto &fmt : {binary::options(), compact, large_xor}) {
+        large_buf.clear();
+        stream::memory_sink number_sink(large_buf);
+        binary::serialize_to(std::tie(large_d, large_ll), number_sink, fmt);
+        std::vector<double> large_d1;
+        std::vector<long long> large_ll1;
+        stream::memory_source number_source(large_buf);
+        binary::decoder<stream::memory_source> number_dec(number_source, fmt);
+        large_before = allocation_count;
+        binary::deserialize_helper(large_d1, number_dec);
+        binary::deserialize_helper(large_ll1, number_dec);
+        large_ok = large_ok && allocation_count - large_before == 2 && large_d1 == large_d && large_ll1 == large_ll &&
+                   large_d1.capacity() == large_d.size() && large_ll1.capacity() == large_ll.size();
+    }
+    if (large_ok && large_allocations[0] == 1 && large_allocations[1] == 1 && large_allocations[2] == 1) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for serializing UserDefinedType through a file descriptor: \n";
+    int fd = open("ufd.data", O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    {
+        stream::fd_sink fsink(fd);
+        binary::serialize_to(u1, fsink);
+    }
+    close(fd);
+    UserDefinedType u3;
+    fd = open("ufd.data", O_RDONLY);
+    stream::fd_source fsource(fd);
+    binary::deserialize_from(u3, fsource);
+    close(fd);
+    std::cout << "Serialize: " << u1.idx << " " << u1.name << " " << u1.data.size() << std::endl;
+    std::cout << "Deserialize: " << u3.idx << " " << u3.name << " " << u3.data.size() << std::endl;
+    if (u1 == u3) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for serializing std::map<int, std::vector<int>> through a FILE *: \n";
+    FILE *file = fopen("mvfile.data", "wb");
+    stream::file_sink file_sink(file);
+    binary::serialize_to(mv1, file_sink);
+    fclose(file);
+    std::map<int, std::vector<int>> mv3;
+    file = fopen("mvfile.data", "rb");
+    stream::file_source file_source(file);
+    binary::deserialize_from(mv3, file_source);
+    fclose(file);
+    std::cout << "Serialize: " << mv1.size() << " entries\n";
+    std::cout << "Deserialize: " << mv3.size() << " entries\n";
+    if (mv1 == mv3) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for serializing TiedStruct: \n";
+    TiedStruct t3{2, "tied", {1.5, 2.5}}, t4;
+    binary::serialize(t3, "tied.data");
+    binary::deserialize(t4, "tied.data");
+    std::cout << "Serialize: " << t3.idx << " " << t3.name << " " << t3.data.size() << std::endl;
+    std::cout << "Deserialize: " << t4.idx << " " << t4.name << " " << t4.data.size() << std::endl;
+    if (t3 == t4) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for deserializing std::vector<MyStruct> from a mapped file: \n";
+    std::vector<MyStruct> vs5, vs6;
+    binary::deserialize_mapped(vs5, "vs.data");
+    binary::deserialize_mapped(vs6, "vsc.data", compact, true);
+    std::cout << "Deserialize: " << vs5.size() << " and " << vs6.size() << " elements" << std::endl;
+    if (vs5 == vs1 && vs6 == vs3) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for serializing std::set<std::string> and std::map<std::string, int>: \n";
+    std::set<std::string> ss2{"delta", "alpha", "charlie", "bravo"}, ss3;
+    std::map<std::string, int> ms1{{"one", 1}, {"two", 2}, {"three", 3}}, ms2;
+    binary::serialize(std::make_tuple(ss2, ms1), "ss.data");
+    auto sm = std::make_tuple(ss3, ms2);
+    binary::deserialize(sm, "ss.data");
+    std::cout << "Deserialize: " << std::get<0>(sm).size() << " keys and " << std::get<1>(sm).size() << " entries"
+              << std::endl;
+    if (std::get<0>(sm) == ss2 && std::get<1>(sm) == ms1) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for deserializing Message into an existing object: \n";
+    std::string longer(40, 'l');
+    Message msg1{9, "a topic longer than the small string buffer", {"tag " + longer, "other tag " + longer},
+                 {{1, "first " + longer}, {2, "second " + longer}}, {"key a " + longer, "key b " + longer},
+                 {"note " + longer}, {0.5, 1.5, 2.5}};
+    bool reuse_ok = true;
+    // the compact format bit-packs the keys of fields and front codes the ones of keys, and the
+    // dictionary of strings takes over the table of the deserialization before
+    binary::options reuse_formats[4];
+    reuse_formats[1].compact = true;
+    reuse_formats[2].string_dictionary = true;
+    reuse_formats[3].compact = true;
+    reuse_formats[3].string_dictionary = true;
+    for (const binary::options &write_opts : reuse_formats) {
+        binary::options reuse = write_opts;
+        reuse.reuse = true;
+        Message msg2, msg3;
+        buf.clear();
+        binary::serialize_to(msg1, msink, write_opts);
+        size_t reuse_allocations = 0;
+        for (int i = 0; i < 3; i++) {
+            stream::memory_source reuse_source(buf);
+            size_t before = allocation_count;
+            binary::deserialize_from(msg2, reuse_source, reuse);
+            reuse_allocations = allocation_count - before;
+            // without reuse the containers are replaced instead of appended to
+            stream::memory_source replace_source(buf);
+            binary::deserialize_from(msg3, replace_source, write_opts);
+        }
+        std::cout << "Allocations of a reused deserialization" << (write_opts.compact ? ", compact" : "")
+                  << (write_opts.string_dictionary ? ", with the dictionary" : "") << ": " << reuse_allocations
+                  << std::endl;
+        reuse_ok = reuse_ok && msg2 == msg1 && msg3 == msg1 && reuse_allocations == 0;
+    }
+    if (reuse_ok) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for serializing std::array: \n";
+    std::array<int, 4> ai1{1, -2, 300, 40000}, ai2, ai3;
+    std::array<std::string, 2> as1{"first", "second"}, as2;
+    binary::serialize(std::make_tuple(ai1, as1), "arr.data");
+    auto arrays = std::make_tuple(ai2, as2);
+    binary::deserialize(arrays, "arr.data");
+    buf.clear();
+    binary::serialize_to(ai1, msink, compact);
+    stream::memory_source array_source(buf);
+    binary::deserialize_from(ai3, array_source, compact);
+    std::cout << "Deserialize: " << std::get<0>(arrays)[3] << " " << std::get<1>(arrays)[1] << std::endl;
+    if (std::get<0>(arrays) == ai1 && std::get<1>(arrays) == as1 && ai3 == ai1) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for computing the serialized size: \n";
+    constexpr std::tuple<int, double, std::pair<short, char>, std::array<long long, 3>> fixed1{1, 2.5, {3, 'c'}, {}};
+    constexpr size_t fixed_bytes = binary::serialized_size(fixed1);
+    static_assert(fixed_bytes == 4 + 8 + 2 + 1 + 3 * 8, "the size of a fixed-shape tuple is a constant");
+    static_assert(binary::serialized_size(Telemetry()) == 4 + sizeof(Telemetry), "the layout guard and the bytes");
+    auto fixed2 = fixed1;
+    buf.clear();
+    binary::serialize_to(fixed2, msink);
+    bool sizes_match = buf.size() == fixed_bytes;
+    // the compact size is measured, and bounded by the maximum of the type
+    buf.clear();
+    binary::serialize_to(fixed2, msink, compact);
+    sizes_match = sizes_match && buf.size() == binary::serialized_size(fixed2, compact) &&
+                  buf.size() <= binary::max_serialized_size<decltype(fixed2)>(compact);
+    for (const binary::options &fmt : {binary::options(), compact}) {
+        std::vector<char> exact;
+        stream::memory_sink exact_sink(exact);
+        size_t size = binary::serialized_size(u1, fmt) + binary::serialized_size(mv1, fmt);
+        exact_sink.reserve(size);
+        const char *storage = exact.data();
+        binary::serialize_to(u1, exact_sink, fmt);
+        binary::serialize_to(mv1, exact_sink, fmt);
+        // the reserved storage was exactly enough
+        sizes_match = sizes_match && exact.size() == size && exact.data() == storage;
+    }
+    std::cout << "Size: " << fixed_bytes << " bytes of a fixed-shape tuple" << std::endl;
+    if (sizes_match) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for writing and reading many objects through one file: \n";
+    bool batch_ok = true;
+    {
+        binary::writer batch_writer("batch.data");
+        batch_writer.reserve(100 * binary::serialized_size(MyStruct(0, 0, "batch")));
+        for (int i = 0; i < 100; i++) {
+            batch_writer.write(MyStruct(i, i * 0.5, "batch"));
+        }
+        batch_writer.write(u1);
+        batch_writer.write(mv1);
+        batch_writer.flush();
+        // everything before the flush can be read while the writer is still open
+        binary::reader early_reader("batch.data");
+        MyStruct first;
+        early_reader.read(first);
+        batch_writer.write(std::string("last"));
+        batch_ok = first == MyStruct(0, 0, "batch");
+    }
+    for (unsigned threads : {1u, 4u}) {
+        // with the block stage the space is reserved behind the blocks in the file, not at the
+        // position of the encoder before compression, and the writing threads are drained first
+        binary::options sum_opts;
+        sum_opts.checksum = true;
+        sum_opts.threads = threads;
+        binary::writer reserve_writer("reserve.data", sum_opts);
+        reserve_writer.write(std::vector<char>((2 << 20) + 100, 'r'));
+        reserve_writer.reserve(1 << 20);
+        reserve_writer.flush();
+        // the reserved space lies past the end of the file, which holds every block written before
+        struct stat reserved;
+        ::stat("reserve.data", &reserved);
+        // file systems without fallocate reserve nothing
+        int probe = open("reserve.data", O_WRONLY);
+        bool reserves = ::fallocate(probe, FALLOC_FL_KEEP_SIZE, 0, 1) == 0;
+        close(probe);
+        batch_ok = batch_ok && reserved.st_size > (2 << 20) &&
+                   (!reserves || reserved.st_blocks * 512 >= reserved.st_size + (1 << 20));
+    }
+    binary::reader batch_reader("batch.data");
+    for (int i = 0; i < 100; i++) {
+        MyStruct ms;
+        batch_reader.read(ms);
+        batch_ok = batch_ok && ms == MyStruct(i, i * 0.5, "batch");
+    }
+    UserDefinedType batch_u;
+    std::map<int, std::vector<int>> batch_mv;
+    std::string batch_last;
+    batch_reader.read(batch_u);
+    batch_reader.read(batch_mv);
+    batch_reader.read(batch_last);
+    std::cout << "Deserialize: 100 MyStruct, " << batch_u.name << ", " << batch_mv.size() << " entries and "
+              << batch_last << std::endl;
+    if (batch_ok && batch_u == u1 && batch_mv == mv1 && batch_last == "last") {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for the LZ codec of the compression stage: \n";
+    std::vector<std::string> lz_inputs{"", "tiny", std::string(100000, 'r'), "abcabcabcabcabcabcabcabcabcabc"};
+    std::string noise(70000, ' ');
+    for (auto &c : noise) {
+        c = static_cast<char>(std::rand());
+    }
+    lz_inputs.push_back(noise);
+    lz_inputs.push_back(noise.substr(0, 30000) + noise.substr(0, 30000) + std::string(300, 'x'));
+    bool lz_ok = true;
+    for (auto &in : lz_inputs) {
+        std::vector<char> packed(compress::lz_bound(in.size()));
+        packed.resize(compress::lz_compress(in.data(), in.size(), packed.data()));
+        std::string out(in.size(), '\0');
+        compress::lz_decompress(packed.data(), packed.size(), &out[0], out.size());
+        lz_ok = lz_ok && out == in;
+        if (in.size() == 100000) {
+            lz_ok = lz_ok && packed.size() < 1000;
+            packed[packed.size() / 2] ^= 0x5a;
+            try {
+                compress::lz_decompress(packed.data(), packed.size(), &out[0], out.size());
+                lz_ok = lz_ok && out != in;
+            } catch (const std::invalid_argument &) {
+            }
+        }
+    }
+    if (lz_ok) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for serializing compressed blocks: \n";
+    binary::options packed_opts;
+    packed_opts.compress = true;
+    std::vector<MyStruct> cv1;
+    for (int i = 0; i < 20000; i++) {
+        cv1.emplace_back(i % 50, 0.25 * (i % 8), "compressed");
+    }
+    std::vector<MyStruct> cv2, cv3;
+    binary::serialize(cv1, "cv.data");
+    binary::serialize(cv1, "cvz.data", packed_opts);
+    binary::deserialize(cv2, "cvz.data", packed_opts);
+    std::ifstream plain_file("cv.data", std::ios_base::binary | std::ios_base::ate);
+    std::ifstream packed_file("cvz.data", std::ios_base::binary | std::ios_base::ate);
+    size_t plain_size = plain_file.tellg(), packed_size = packed_file.tellg();
+    {
+        binary::writer packed_writer("cvw.data", packed_opts);
+        packed_writer.write(u1);
+        packed_writer.write(cv1);
+        packed_writer.write(mv1);
+    }
+    binary::reader packed_reader("cvw.data", packed_opts);
+    UserDefinedType cu;
+    std::map<int, std::vector<int>> cmv;
+    packed_reader.read(cu);
+    packed_reader.read(cv3);
+    packed_reader.read(cmv);
+    std::cout << "Size: " << plain_size << " bytes plain, " << packed_size << " bytes compressed" << std::endl;
+    if (cv2 == cv1 && cv3 == cv1 && cu == u1 && cmv == mv1 && packed_size * 4 < plain_size &&
+        binary::serialized_size(cv1, packed_opts) == packed_size) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for compressing blocks on threads: \n";
+    binary::options parallel_opts = packed_opts;
+    parallel_opts.threads = 4;
+    std::vector<char> serial_buf, parallel_buf;
+    stream::memory_sink serial_sink(serial_buf), parallel_sink(parallel_buf);
+    binary::serialize_to(cv1, serial_sink, packed_opts);
+    binary::serialize_to(cv1, parallel_sink, parallel_opts);
+    std::vector<MyStruct> pv1, pv2;
+    stream::memory_source parallel_source(parallel_buf);
+    binary::deserialize_from(pv1, parallel_source, parallel_opts);
+    {
+        binary::writer parallel_writer("cvp.data", parallel_opts);
+        parallel_writer.write(cv1);
+        parallel_writer.write(u1);
+    }
+    binary::reader parallel_reader("cvp.data", parallel_opts);
+    UserDefinedType pu;
+    parallel_reader.read(pv2);
+    parallel_reader.read(pu);
+    // a corrupt header in the third block is found by the thread reading ahead
+    std::vector<char> corrupt_buf = parallel_buf;
+    size_t header_pos = 0;
+    for (int i = 0; i < 2; i++) {
+        compress::block_header header;
+        std::memcpy(&header, corrupt_buf.data() + header_pos, sizeof(header));
+        header_pos += sizeof(header) + header.stored_size;
+    }
+    compress::block_header bad{1, 2};
+    std::memcpy(corrupt_buf.data() + header_pos, &bad, sizeof(bad));
+    stream::memory_source corrupt_source(corrupt_buf);
+    bool corrupt_found = false;
+    try {
+        std::vector<MyStruct> pv3;
+        binary::deserialize_from(pv3, corrupt_source, parallel_opts);
+    } catch (const std::invalid_argument &) {
+        corrupt_found = true;
+    }
+    // a compressing thread which runs out of memory hands the exception to the caller
+    bool pack_failure_found = false;
+    {
+        std::vector<char> failing_buf;
+        stream::memory_sink failing_sink(failing_buf);
+        compress::block_options failing_opts;
+        failing_opts.threads = 4;
+        failing_opts.block_size = 1 << 12;
+        compress::block_sink<stream::memory_sink> failing_blocks(failing_sink, failing_opts);
+        std::vector<char> failing_raw(1 << 16, 'f');
+        fail_thread_allocations = true;
+        try {
+            failing_blocks.write(failing_raw.data(), failing_raw.size());
+            failing_blocks.flush();
+        } catch (const std::bad_alloc &) {
+            pack_failure_found = true;
+        }
+        fail_thread_allocations = false;
+    }
+    std::cout << "Blocks: " << parallel_buf.size() << " bytes on 4 threads, " << serial_buf.size()
+              << " bytes on 1" << std::endl;
+    if (parallel_buf == serial_buf && pv1 == cv1 && pv2 == cv1 && pu == u1 && corrupt_found && pack_failure_found) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for CRC32C checksums: \n";
+    const char check_input[] = "123456789";
+    bool crc_ok = checksum::crc32c(check_input, 9) == 0xe3069283u;
+    std::string crc_data;
+    for (int i = 0; i < 20000; i++) {
+        crc_data.push_back(static_cast<char>(i * 131 + i / 7));
+    }
+    for (size_t n : {0, 1, 3, 7, 8, 9, 15, 64, 1000, 6144, 20000}) {
+        uint32_t whole = checksum::crc32c(crc_data.data(), n);
+        uint32_t split = checksum::crc32c(checksum::crc32c(crc_data.data(), n / 3), crc_data.data() + n / 3, n - n / 3);
+        uint32_t scalar = ~checksum::crc32c_scalar(~0u, crc_data.data(), n);
+        crc_ok = crc_ok && whole == split && whole == scalar;
+    }
+    if (crc_ok) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for detecting corrupt and truncated streams with checksums: \n";
+    bool checked_ok = true;
+    for (int mode = 0; mode < 4; mode++) {
+        binary::options sum_opts;
+        sum_opts.checksum = true;
+        sum_opts.compress = mode & 1;
+        sum_opts.threads = mode & 2 ? 4 : 1;
+        std::vector<char> sum_buf;
+        stream::memory_sink sum_sink(sum_buf);
+        binary::serialize_to(cv1, sum_sink, sum_opts);
+        std::vector<MyStruct> sv1;
+        stream::memory_source sum_source(sum_buf);
+        binary::deserialize_from(sv1, sum_source, sum_opts);
+        checked_ok = checked_ok && sv1 == cv1 && binary::serialized_size(cv1, sum_opts) == sum_buf.size();
+        // a flipped bit in the first block, the last block and the end of the stream
+        for (size_t pos : {sum_buf.size() / 3, sum_buf.size() - 20, sum_buf.size() - 2}) {
+            std::vector<char> bad_buf = sum_buf;
+            bad_buf[pos] ^= 0x10;
+            stream::memory_source bad_source(bad_buf);
+            bool found = false;
+            try {
+                std::vector<MyStruct> sv2;
+                binary::deserialize_from(sv2, bad_source, sum_opts);
+            } catch (const std::invalid_argument &) {
+                found = true;
+            }
+            checked_ok = checked_ok && found;
+        }
+        stream::memory_source short_source(sum_buf.data(), sum_buf.size() - 1);
+        bool truncated = false;
+        try {
+            std::vector<MyStruct> sv3;
+            binary::deserialize_from(sv3, short_source, sum_opts);
+        } catch (const std::out_of_range &) {
+            truncated = true;
+        }
+        checked_ok = checked_ok && truncated;
+    }
+    {
+        binary::options sum_opts;
+        sum_opts.checksum = true;
+        {
+            binary::writer sum_writer("cvs.data", sum_opts);
+            sum_writer.write(cv1);
+            sum_writer.write(u1);
+        }
+        binary::reader sum_reader("cvs.data", sum_opts);
+        std::vector<MyStruct> sv4;
+        UserDefinedType su;
+        sum_reader.read(sv4);
+        sum_reader.read(su);
+        checked_ok = checked_ok && sv4 == cv1 && su == u1;
+    }
+    {
+        // the header, the bytes and the checksum of one block, then the end and its checksum
+        binary::options sum_opts;
+        sum_opts.checksum = true;
+        std::tuple<int, double> fixed{7, 0.5};
+        std::vector<char> fixed_buf;
+        stream::memory_sink fixed_sink(fixed_buf);
+        binary::serialize_to(fixed, fixed_sink, sum_opts);
+        checked_ok = checked_ok && fixed_buf.size() == 12 + 12 + 12 &&
+                     binary::serialized_size(fixed, sum_opts) == fixed_buf.size() &&
+                     binary::max_serialized_size<std::tuple<int, double>>(sum_opts) >= fixed_buf.size();
+    }
+    std::cout << (checked_ok ? "[true]\n" : "[false]\n");
+
+    std::cout << "Test for rejecting truncated files and corrupt sizes: \n";
+    // a short file read through std::fstream throws instead of leaving garbage behind
+    binary::serialize(v1, "trunc.data");
+    ::truncate("trunc.data", 10);
+    bool short_file = false;
+    try {
+        std::vector<int> tv;
+        binary::deserialize(tv, "trunc.data");
+    } catch (const std::out_of_range &) {
+        short_file = true;
+    }
+    // a size of billions of elements with a few bytes behind it fails at the end of the stream
+    // without being allocated first
+    std::vector<char> huge_buf;
+    stream::memory_sink huge_sink(huge_buf);
+    binary::serialize_to(std::vector<int>{1, 2, 3}, huge_sink);
+    uint32_t huge_size = 0xfffffff0u;
+    std::memcpy(huge_buf.data(), &huge_size, sizeof(huge_size));
+    bool huge_rejected[3] = {false, false, false};
+    try {
+        std::vector<double> hv;
+        stream::memory_source huge_source(huge_buf);
+        binary::deserialize_from(hv, huge_source);
+    } catch (const std::out_of_range &) {
+        huge_rejected[0] = true;
+    }
+    try {
+        std::string hs;
+        stream::memory_source huge_source(huge_buf);
+        binary::deserialize_from(hs, huge_source);
+    } catch (const std::out_of_range &) {
+        huge_rejected[1] = true;
+    }
+    try {
+        std::vector<std::string> hv;
+        stream::memory_source huge_source(huge_buf);
+        binary::deserialize_from(hv, huge_source);
+    } catch (const std::out_of_range &) {
+        huge_rejected[2] = true;
+    }
+    if (short_file && huge_rejected[0] && huge_rejected[1] && huge_rejected[2]) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for byte swapping kernels: \n";
+    bool swap_ok = true;
+    std::vector<char> swap_in(1000), swap_out(1000), swap_ref(1000);
+    for (size_t i = 0; i < swap_in.size(); i++) {
+        swap_in[i] = static_cast<char>(i * 7 + 1);
+    }
+    for (size_t n : {0, 1, 3, 8, 31, 125}) {
+        codec::byte_swap<8>(swap_in.data(), n, swap_out.data());
+        codec::byte_swap_scalar<8>(swap_in.data(), n, swap_ref.data());
+        swap_ok = swap_ok && std::equal(swap_out.begin(), swap_out.begin() + 8 * n, swap_ref.begin());
+        codec::byte_swap<4>(swap_in.data(), 2 * n, swap_out.data());
+        codec::byte_swap_scalar<4>(swap_in.data(), 2 * n, swap_ref.data());
+        swap_ok = swap_ok && std::equal(swap_out.begin(), swap_out.begin() + 8 * n, swap_ref.begin());
+        codec::byte_swap<2>(swap_in.data(), 4 * n, swap_out.data());
+        codec::byte_swap_scalar<2>(swap_in.data(), 4 * n, swap_ref.data());
+        swap_ok = swap_ok && std::equal(swap_out.begin(), swap_out.begin() + 8 * n, swap_ref.begin());
+    }
+    swap_ok = swap_ok && codec::byte_swapped<uint32_t>(0x01020304u) == 0x04030201u && swap_ref[0] == swap_in[1];
+    if (swap_ok) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for serializing in a fixed byte order: \n";
+    binary::options big_opts, little_opts, native_opts;
+    big_opts.order = binary::byte_order::big;
+    little_opts.order = binary::byte_order::little;
+    std::vector<double> ov1(1000);
+    std::vector<int16_t> ov2(1001);
+    std::vector<uint64_t> ov3(999);
+    for (size_t i = 0; i < ov1.size(); i++) {
+        ov1[i] = i * 0.25 - 7;
+    }
+    for (size_t i = 0; i < ov2.size(); i++) {
+        ov2[i] = static_cast<int16_t>(i * 37 - 9000);
+    }
+    for (size_t i = 0; i < ov3.size(); i++) {
+        ov3[i] = 0x0102030405060708ull * i;
+    }
+    auto ordered1 = std::make_tuple(int16_t(-2), 0x01020304u, -5ll, 1.5f, 2.75, std::string("order"), ov1, ov2, ov3, mv1);
+    bool order_ok = true;
+    std::vector<char> order_bufs[3];
+    binary::options order_opts[3] = {native_opts, little_opts, big_opts};
+    for (int compact = 0; compact < 2; compact++) {
+        for (int i = 0; i < 3; i++) {
+            order_opts[i].compact = compact;
+            order_bufs[i].clear();
+            stream::memory_sink order_sink(order_bufs[i]);
+            binary::serialize_to(ordered1, order_sink, order_opts[i]);
+            decltype(ordered1) ordered2;
+            stream::memory_source order_source(order_bufs[i]);
+            binary::deserialize_from(ordered2, order_source, order_opts[i]);
+            order_ok = order_ok && ordered2 == ordered1;
+        }
+        // the host is the one order which is stored as it is
+        bool host_little = std::endian::native == std::endian::little;
+        order_ok = order_ok && order_bufs[0] == order_bufs[host_little ? 1 : 2] &&
+                   order_bufs[0] != order_bufs[host_little ? 2 : 1] && order_bufs[1].size() == order_bufs[2].size();
+    }
+    std::vector<char> big_buf;
+    stream::memory_sink big_sink(big_buf);
+    binary::serialize_to(0x01020304u, big_sink, big_opts);
+    order_ok = order_ok && big_buf == std::vector<char>{1, 2, 3, 4};
+    big_buf.clear();
+    binary::serialize_to(std::vector<uint16_t>{0x0102, 0x0304}, big_sink, big_opts);
+    order_ok = order_ok && big_buf == std::vector<char>{0, 0, 0, 2, 1, 2, 3, 4};
+    bool raw_rejected = false;
+    try {
+        Telemetry tm3{};
+        binary::serialize_to(tm3, big_sink, std::endian::native == std::endian::little ? big_opts : little_opts);
+    } catch (const std::invalid_argument &) {
+        raw_rejected = true;
+    }
+    if (order_ok && raw_rejected) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for serializing trivially serializable Telemetry as raw bytes: \n";
+    Telemetry tm1{3, 1, 20.5, 1700000000000ll, {0.5f, 1.5f, 2.5f, 3.5f}}, tm2;
+    binary::serialize(tm1, "tm.data");
+    binary::deserialize(tm2, "tm.data");
+    std::vector<Telemetry> tv1(1000, tm1), tv2;
+    for (int i = 0; i < 1000; i++) {
+        tv1[i].sensor = i;
+    }
+    buf.clear();
+    binary::serialize_to(tv1, msink);
+    // the size, the layout guard and the elements as one block
+    bool raw_size = buf.size() == 4 + 4 + sizeof(Telemetry) * tv1.size();
+    stream::memory_source tsource(buf);
+    binary::deserialize_from(tv2, tsource);
+    std::vector<PackedTelemetry> tv3;
+    stream::memory_source wrong_source(buf);
+    bool guarded = false;
+    try {
+        binary::deserialize_from(tv3, wrong_source);
+    } catch (const std::invalid_argument &) {
+        guarded = true;
+    }
+    std::cout << "Serialize: " << tv1.size() << " records in " << buf.size() << " bytes" << std::endl;
+    std::cout << "Deserialize: " << tv2.size() << " records" << std::endl;
+    if (tm1 == tm2 && tv1 == tv2 && raw_size && guarded) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for deserializing std::string_view and std::span views: \n";
+    std::vector<double> ds1{0.5, 1.5, 2.5, 3.5};
+    std::vector<std::string> ss1{"view", std::string("embedded\0zero", 13), std::string(100, 'v')};
+    // the size of the span ends at an odd offset, so its elements are padded
+    binary::options aligned;
+    aligned.aligned = true;
+    std::tuple<char, std::span<const double>, std::vector<std::string>> views1{'v', ds1, ss1};
+    buf.clear();
+    binary::serialize_to(views1, msink, aligned);
+    std::tuple<char, std::span<const double>, std::vector<std::string_view>> views2;
+    stream::memory_source view_source(buf);
+    binary::deserialize_from(views2, view_source, aligned);
+    auto in_buf = [&buf](const void *p) {
+        return p >= buf.data() && p < buf.data() + buf.size();
+    };
+    bool views_ok = std::get<0>(views2) == 'v' && std::equal(ds1.begin(), ds1.end(), std::get<1>(views2).begin(),
+                                                           std::get<1>(views2).end()) &&
+                    in_buf(std::get<1>(views2).data()) && std::get<2>(views2).size() == ss1.size();
+    for (size_t i = 0; views_ok && i < ss1.size(); i++) {
+        views_ok = std::get<2>(views2)[i] == ss1[i] && in_buf(std::get<2>(views2)[i].data());
+    }
+    binary::serialize(views1, "views.data", aligned);
+    stream::mmap_source view_file("views.data");
+    std::tuple<char, std::span<const double>, std::vector<std::string_view>> views3;
+    binary::deserialize_from(views3, view_file, aligned);
+    views_ok = views_ok && std::get<0>(views3) == 'v' &&
+               std::equal(ds1.begin(), ds1.end(), std::get<1>(views3).begin(), std::get<1>(views3).end()) &&
+               std::get<2>(views3) == std::get<2>(views2);
+    std::vector<char> shifted(buf.size() + 1);
+    std::copy(buf.begin(), buf.end(), shifted.begin() + 1);
+    stream::memory_source shifted_source(shifted.data() + 1, buf.size());
+    bool misaligned = false;
+    try {
+        binary::deserialize_from(views3, shifted_source, aligned);
+    } catch (const std::invalid_argument &) {
+        misaligned = true;
+    }
+    // vectors are written like spans, so they are read back as spans and the other way around
+    std::vector<double> ds2{5.25, -1.0};
+    std::tuple<char, std::vector<double>, std::vector<double>> vecs1{'w', ds1, ds2}, vecs2;
+    buf.clear();
+    binary::serialize_to(vecs1, msink, aligned);
+    std::tuple<char, std::span<const double>, std::span<const double>> spans1;
+    stream::memory_source vec_source(buf);
+    binary::deserialize_from(spans1, vec_source, aligned);
+    views_ok = views_ok && std::equal(ds1.begin(), ds1.end(), std::get<1>(spans1).begin(), std::get<1>(spans1).end()) &&
+               std::equal(ds2.begin(), ds2.end(), std::get<2>(spans1).begin(), std::get<2>(spans1).end()) &&
+               in_buf(std::get<2>(spans1).data()) && vec_source.position() == buf.size() &&
+               binary::serialized_size(vecs1, aligned) == buf.size();
+    buf.clear();
+    binary::serialize_to(spans1, msink, aligned);
+    stream::memory_source span_source(buf);
+    binary::deserialize_from(vecs2, span_source, aligned);
+    views_ok = views_ok && vecs2 == vecs1;
+    // without options::aligned the doubles behind the size of 4 bytes are not aligned, and the
+    // compact format packs integers, so neither can be pointed to
+    buf.clear();
+    binary::serialize_to(vecs1, msink);
+    bool unaligned = false, packed = false;
+    try {
+        stream::memory_source unaligned_source(buf);
+        binary::deserialize_from(spans1, unaligned_source);
+    } catch (const std::invalid_argument &) {
+        unaligned = true;
+    }
+    buf.clear();
+    binary::serialize_to(std::vector<int>{1, 2, 3}, msink, compact);
+    try {
+        std::span<const int> packed_span;
+        stream::memory_source packed_source(buf);
+        binary::deserialize_from(packed_span, packed_source, compact);
+    } catch (const std::invalid_argument &) {
+        packed = true;
+    }
+    views_ok = views_ok && unaligned && packed;
+    // columns are encoded apart from the stream and pad nothing
+    binary::options aligned_columns = aligned;
+    aligned_columns.columnar = true;
+    std::vector<UserDefinedType> acol1{u4, {5, "b", {0.25}}}, acol2;
+    buf.clear();
+    binary::serialize_to(acol1, msink, aligned_columns);
+    stream::memory_source acol_source(buf);
+    binary::deserialize_from(acol2, acol_source, aligned_columns);
+    views_ok = views_ok && acol2 == acol1 && acol_source.position() == buf.size();
+    std::cout << "Deserialize: " << std::get<1>(views2).size() << " doubles and " << std::get<2>(views2).size()
+              << " strings in place" << std::endl;
+    if (views_ok && misaligned) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
     std::cout << "Test for serializing std::unique_ptr<int>: \n";
     std::unique_ptr<int> up1(new int(1)), up2;
     binary::serialize(up1, "up.data");
@@ -291,7 +1458,7 @@ int main() {
     }
 
     std::cout << "Test for serializing std::shared_ptr<int>: \n";
-    std::unique_ptr<int> sh1(new int(1)), sh2;
+    std::shared_ptr<int> sh1(new int(1)), sh2;
     binary::serialize(sh1, "up.data");
     binary::deserialize(sh2, "up.data");
     std::cout << "Serialize: " << *sh1 << std::endl << "Deserialize: " << *sh2 << std::endl;
@@ -351,5 +1518,543 @@ int main() {
     } else {
         std::cout << "[false]\n";
     }
+
+    std::cout << "Test for preserving the identity of std::shared_ptr: \n";
+    auto config = std::make_shared<MyStruct>(7, 0.5, std::string(200, 'c'));
+    std::vector<std::shared_ptr<MyStruct>> shared1(10000, config), shared2;
+    shared1[3] = nullptr;
+    shared1[5] = std::make_shared<MyStruct>(*config);
+    std::vector<MyStruct> copies(10000, *config);
+    bool shared_ok = true;
+    for (const auto &opts : {binary::options(), binary::options{.compact = true}}) {
+        std::vector<char> shared_buf;
+        stream::memory_sink shared_sink(shared_buf);
+        binary::serialize_to(shared1, shared_sink, opts);
+        stream::memory_source shared_source(shared_buf);
+        binary::deserialize_from(shared2, shared_source, opts);
+        shared_ok = shared_ok && shared_buf.size() < binary::serialized_size(copies, opts) / 20 &&
+                    shared2.size() == shared1.size() && shared2[3] == nullptr && *shared2[0] == *config &&
+                    shared2[5] != shared2[0] && *shared2[5] == *config;
+        for (size_t k = 0; k < shared2.size(); k++) {
+            shared_ok = shared_ok && (k == 3 || k == 5 || shared2[k] == shared2[0]);
+        }
+        std::cout << "Serialize: " << shared_buf.size() << " bytes for " << shared1.size() << " pointers, "
+                  << binary::serialized_size(copies, opts) << " bytes for copies" << std::endl;
+    }
+    // the ids live as long as the writer and the reader
+    {
+        binary::writer shared_writer("shared.data");
+        shared_writer.write(config);
+        shared_writer.write(shared1);
+    }
+    binary::reader shared_reader("shared.data");
+    std::shared_ptr<MyStruct> first_config;
+    shared_reader.read(first_config);
+    shared_reader.read(shared2);
+    shared_ok = shared_ok && shared2[0] == first_config && shared2[9999] == first_config;
+    // the second pointer refers to an id which was never written
+    std::vector<std::shared_ptr<MyStruct>> twice{config, config};
+    std::vector<char> backref_buf;
+    stream::memory_sink backref_sink(backref_buf);
+    binary::serialize_to(twice, backref_sink);
+    backref_buf.back() = 7;
+    stream::memory_source backref_source(backref_buf);
+    try {
+        binary::deserialize_from(shared2, backref_source);
+        shared_ok = false;
+    } catch (const std::invalid_argument &) {
+    }
+    if (shared_ok) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for serializing a graph with std::weak_ptr cycles: \n";
+    auto root1 = std::make_shared<TreeNode>();
+    root1->name = "root";
+    for (int k = 0; k < 3; k++) {
+        auto child = std::make_shared<TreeNode>();
+        child->name = "child" + std::to_string(k);
+        child->parent = root1;
+        root1->children.push_back(child);
+    }
+    // a node reachable along two paths is still a single node
+    root1->children[2]->children.push_back(root1->children[0]);
+    std::shared_ptr<TreeNode> root2;
+    binary::serialize(root1, "tree.data");
+    binary::deserialize(root2, "tree.data");
+    bool tree_ok = root2 && root2->name == "root" && root2->parent.expired() && root2->children.size() == 3 &&
+                   root2->children[2]->children.size() == 1 &&
+                   root2->children[2]->children[0] == root2->children[0];
+    for (int k = 0; tree_ok && k < 3; k++) {
+        tree_ok = root2->children[k]->name == "child" + std::to_string(k) && root2->children[k]->parent.lock() == root2;
+    }
+    std::cout << "Deserialize: " << root2->name << " with " << root2->children.size() << " children, "
+              << root2.use_count() << " owner" << std::endl;
+    if (tree_ok && root2.use_count() == 1) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for serializing vectors of user types in columns: \n";
+    std::vector<MyStruct> rows1;
+    std::vector<Message> messages1(300);
+    for (int k = 0; k < 5000; k++) {
+        rows1.emplace_back(k * 3 - 700, k * 0.125, "row" + std::to_string(k % 17));
+    }
+    for (int k = 0; k < 300; k++) {
+        messages1[k].id = k;
+        messages1[k].topic = "topic" + std::to_string(k % 3);
+        messages1[k].tags = {"a", std::to_string(k)};
+        messages1[k].fields = {{k, "field"}};
+        messages1[k].values = {k * 0.5, -1.0};
+    }
+    auto columns1 = std::make_tuple(rows1, messages1, std::vector<TiedStruct>{{1, "x", {0.5}}, {2, "y", {}}}, 42);
+    bool columns_ok = true;
+    binary::options column_formats[5];
+    column_formats[1].compact = true;
+    column_formats[2].order = binary::byte_order::big;
+    column_formats[3].compress = true;
+    column_formats[4].checksum = true;
+    column_formats[4].compact = true;
+    for (auto &opts : column_formats) {
+        std::vector<char> row_buf, column_buf;
+        stream::memory_sink row_sink(row_buf), column_sink(column_buf);
+        binary::serialize_to(columns1, row_sink, opts);
+        opts.columnar = true;
+        binary::serialize_to(columns1, column_sink, opts);
+        decltype(columns1) columns2;
+        stream::memory_source column_source(column_buf);
+        binary::deserialize_from(columns2, column_source, opts);
+        columns_ok = columns_ok && columns2 == columns1 && column_buf != row_buf &&
+                     binary::serialized_size(columns1, opts) == column_buf.size();
+        // the id and the string columns are skipped, the value column is read
+        opts.column_mask = 0b010;
+        decltype(columns1) masked;
+        stream::memory_source masked_source(column_buf);
+        binary::deserialize_from(masked, masked_source, opts);
+        columns_ok = columns_ok && std::get<3>(masked) == 42 && std::get<0>(masked).size() == rows1.size() &&
+                     std::get<0>(masked)[4999].b == rows1[4999].b && std::get<0>(masked)[4999].a == 0 &&
+                     std::get<0>(masked)[4999].c.empty() && std::get<1>(masked)[299].topic == "topic2" &&
+                     std::get<1>(masked)[299].id == 0 && std::get<2>(masked)[1].name == "y";
+        std::cout << "Serialize: " << row_buf.size() << " bytes in rows, " << column_buf.size() << " bytes in columns"
+                  << std::endl;
+    }
+    // the skipped members keep their values with reuse
+    binary::options reuse_columns;
+    reuse_columns.columnar = true;
+    std::vector<TiedStruct> tied_columns1{{1, "one", {1.0}}, {2, "two", {2.0}}}, tied_columns2{{7, "seven", {}}};
+    std::vector<char> tied_buf;
+    stream::memory_sink tied_sink(tied_buf);
+    binary::serialize_to(tied_columns1, tied_sink, reuse_columns);
+    reuse_columns.reuse = true;
+    reuse_columns.column_mask = 0b101;
+    stream::memory_source tied_source(tied_buf);
+    binary::deserialize_from(tied_columns2, tied_source, reuse_columns);
+    columns_ok = columns_ok && tied_columns2.size() == 2 && tied_columns2[0].idx == 1 && tied_columns2[0].name == "seven" &&
+                 tied_columns2[1].data == std::vector<double>{2.0} && tied_columns2[1].name.empty();
+    // a size no column backs is rejected before it is allocated
+    std::vector<char> huge_columns;
+    stream::memory_sink huge_column_sink(huge_columns);
+    binary::serialize_to(uint32_t(1) << 31, huge_column_sink);
+    binary::serialize_to(uint32_t(8), huge_column_sink);
+    huge_columns.resize(huge_columns.size() + 8);
+    for (uint64_t mask : {~uint64_t(0), uint64_t(0)}) {
+        binary::options huge_opts;
+        huge_opts.columnar = true;
+        huge_opts.column_mask = mask;
+        stream::memory_source huge_source(huge_columns);
+        try {
+            binary::deserialize_from(rows1, huge_source, huge_opts);
+            columns_ok = false;
+        } catch (const std::out_of_range &) {
+        } catch (const std::invalid_argument &) {
+        }
+    }
+    if (columns_ok) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for bit packing the keys of ordered containers: \n";
+    bool keys_ok = true;
+    for (unsigned bits = 0; bits <= 32; bits++) {
+        uint32_t unpacked[codec::bp_frame], scalar[codec::bp_frame], selected[codec::bp_frame];
+        uint8_t packed[codec::bp_size(32)];
+        for (size_t k = 0; k < codec::bp_frame; k++) {
+            unpacked[k] = static_cast<uint32_t>((k * 2654435761u) & (bits == 32 ? ~0u : (1u << bits) - 1));
+        }
+        codec::bp_pack(unpacked, codec::bp_width(unpacked), packed);
+        codec::bp_unpack_scalar(packed, codec::bp_width(unpacked), scalar);
+        codec::bp_unpack(packed, codec::bp_width(unpacked), selected);
+        keys_ok = keys_ok && codec::bp_width(unpacked) <= bits && std::equal(unpacked, unpacked + codec::bp_frame, scalar) &&
+                  std::equal(unpacked, unpacked + codec::bp_frame, selected);
+    }
+    std::set<int> dense1, dense2;
+    for (int k = -5000; k < 5000; k++) {
+        dense1.insert(k);
+    }
+    std::set<int64_t> sparse1{std::numeric_limits<int64_t>::min(), -1, 0, std::numeric_limits<int64_t>::max()}, sparse2;
+    for (int64_t k = 0; k < 1000; k++) {
+        sparse1.insert(k * k * k * 1000003);
+    }
+    std::set<uint16_t> shorts1, shorts2;
+    for (int k = 0; k < 300; k++) {
+        shorts1.insert(static_cast<uint16_t>(k * 211));
+    }
+    std::map<int64_t, std::string> keyed1, keyed2{{5, "old"}};
+    for (int64_t k = 0; k < 1000; k++) {
+        keyed1[k * 3 + (k % 7)] = "value" + std::to_string(k);
+    }
+    binary::options compact_keys;
+    compact_keys.compact = true;
+    auto all_keys1 = std::make_tuple(dense1, sparse1, shorts1, keyed1, std::set<int>{}, std::set<int>{7},
+                                     std::map<int, int>{{-1, 1}, {1, -1}});
+    decltype(all_keys1) all_keys2;
+    std::vector<char> keys_buf;
+    stream::memory_sink keys_sink(keys_buf);
+    binary::serialize_to(all_keys1, keys_sink, compact_keys);
+    stream::memory_source keys_source(keys_buf);
+    binary::deserialize_from(all_keys2, keys_source, compact_keys);
+    keys_ok = keys_ok && all_keys2 == all_keys1;
+    // the consecutive keys all have a gap of 0, which takes no bits
+    size_t dense_size = binary::serialized_size(dense1, compact_keys);
+    std::cout << "Serialize: " << dense1.size() << " consecutive keys in " << dense_size << " bytes, "
+              << binary::serialized_size(dense1) << " bytes in the fixed format" << std::endl;
+    keys_ok = keys_ok && dense_size < 200;
+    // the nodes there are refilled with reuse
+    compact_keys.reuse = true;
+    std::set<int> few_keys{-3, 9, 1000};
+    for (std::set<int> *keys : {&dense1, &few_keys, &dense1}) {
+        std::vector<char> reuse_buf;
+        stream::memory_sink reuse_sink(reuse_buf);
+        binary::serialize_to(*keys, reuse_sink, compact_keys);
+        stream::memory_source reuse_source(reuse_buf);
+        binary::deserialize_from(dense2, reuse_source, compact_keys);
+        keys_ok = keys_ok && dense2 == *keys;
+    }
+    std::vector<char> keyed_buf, shorts_buf;
+    stream::memory_sink keyed_sink(keyed_buf), shorts_sink(shorts_buf);
+    binary::serialize_to(keyed1, keyed_sink, compact_keys);
+    binary::serialize_to(shorts1, shorts_sink, compact_keys);
+    stream::memory_source keyed_source(keyed_buf), shorts_source(shorts_buf);
+    binary::deserialize_from(keyed2, keyed_source, compact_keys);
+    binary::deserialize_from(shorts2, shorts_source, compact_keys);
+    keys_ok = keys_ok && keyed2 == keyed1 && shorts2 == shorts1;
+    // the keys and the values are read into the nodes of the map read before, without allocating
+    stream::memory_source keyed_again(keyed_buf);
+    size_t keyed_allocations = allocation_count;
+    binary::deserialize_from(keyed2, keyed_again, compact_keys);
+    keyed_allocations = allocation_count - keyed_allocations;
+    std::cout << "Allocations of a reused std::map: " << keyed_allocations << std::endl;
+    keys_ok = keys_ok && keyed2 == keyed1 && keyed_allocations == 0;
+    // a frame width past 32 bits is rejected
+    std::vector<char> corrupt_keys;
+    stream::memory_sink corrupt_keys_sink(corrupt_keys);
+    binary::serialize_to(dense1, corrupt_keys_sink, compact_keys);
+    // after the size and the first key, 2 bytes each
+    corrupt_keys[4] = 40;
+    stream::memory_source corrupt_keys_source(corrupt_keys);
+    try {
+        binary::deserialize_from(dense2, corrupt_keys_source, compact_keys);
+        keys_ok = false;
+    } catch (const std::invalid_argument &) {
+    }
+    if (keys_ok) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for XOR compressing floating-point vectors: \n";
+    bool xor_ok = true;
+    // the bits come back exactly, NaN, infinities, negative zero and denormals included
+    std::vector<double> edges1{0.0, -0.0, std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::infinity(),
+                               -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::denorm_min(),
+                               std::numeric_limits<double>::max(), 1.0, 1.0, 1.5, -1e300, 1e-300};
+    std::vector<float> float_edges1{0.0f, -0.0f, std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::infinity(),
+                                    std::numeric_limits<float>::denorm_min(), 3.25f, 3.25f, -3.25f};
+    std::vector<double> smooth1, noisy1;
+    std::vector<float> float_smooth1;
+    for (int k = 0; k < 5000; k++) {
+        smooth1.push_back(20.0 + (k / 16) * 0.25);
+        noisy1.push_back(static_cast<double>(k * 2654435761u % 1000003) / 1000003.0 * 2 - 1);
+        float_smooth1.push_back(static_cast<float>(k % 1000) * 0.5f);
+    }
+    binary::options xor_formats[3];
+    xor_formats[1].compact = true;
+    xor_formats[2].order = binary::byte_order::big;
+    for (auto &opts : xor_formats) {
+        opts.xor_floats = true;
+        auto series1 = std::make_tuple(edges1, float_edges1, smooth1, noisy1, float_smooth1, std::vector<double>{},
+                                       std::vector<float>{2.0f}, std::array<double, 2>{0.5, 0.25});
+        decltype(series1) series2;
+        std::vector<char> series_buf;
+        stream::memory_sink series_sink(series_buf);
+        binary::serialize_to(series1, series_sink, opts);
+        stream::memory_source series_source(series_buf);
+        binary::deserialize_from(series2, series_source, opts);
+        auto same_bits = [](const auto &a, const auto &b) {
+            return a.size() == b.size() && std::memcmp(a.data(), b.data(), sizeof(a[0]) * a.size()) == 0;
+        };
+        xor_ok = xor_ok && same_bits(std::get<0>(series1), std::get<0>(series2)) &&
+                 same_bits(std::get<1>(series1), std::get<1>(series2)) && std::get<2>(series1) == std::get<2>(series2) &&
+                 std::get<3>(series1) == std::get<3>(series2) && std::get<4>(series1) == std::get<4>(series2) &&
+                 std::get<5>(series2).empty() && std::get<6>(series1) == std::get<6>(series2) &&
+                 std::get<7>(series1) == std::get<7>(series2);
+        // the columns of doubles are compressed too
+        opts.columnar = true;
+        std::vector<MyStruct> xor_rows2;
+        std::vector<char> xor_rows_buf;
+        stream::memory_sink xor_rows_sink(xor_rows_buf);
+        binary::serialize_to(rows1, xor_rows_sink, opts);
+        stream::memory_source xor_rows_source(xor_rows_buf);
+        binary::deserialize_from(xor_rows2, xor_rows_source, opts);
+        xor_ok = xor_ok && xor_rows2 == rows1;
+    }
+    binary::options xor_opts;
+    xor_opts.xor_floats = true;
+    size_t smooth_size = binary::serialized_size(smooth1, xor_opts);
+    std::cout << "Serialize: " << smooth1.size() << " slowly changing doubles in " << smooth_size << " bytes, "
+              << binary::serialized_size(smooth1) << " bytes without XOR" << std::endl;
+    xor_ok = xor_ok && smooth_size * 5 < binary::serialized_size(smooth1);
+    // a frame longer than its numbers can take is rejected
+    std::vector<char> corrupt_xor;
+    stream::memory_sink corrupt_xor_sink(corrupt_xor);
+    binary::serialize_to(smooth1, corrupt_xor_sink, xor_opts);
+    corrupt_xor[4] = static_cast<char>(0xff);
+    corrupt_xor[5] = static_cast<char>(0xff);
+    stream::memory_source corrupt_xor_source(corrupt_xor);
+    try {
+        binary::deserialize_from(smooth1, corrupt_xor_source, xor_opts);
+        xor_ok = false;
+    } catch (const std::invalid_argument &) {
+    }
+    if (xor_ok) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for the dictionary of repeated strings: \n";
+    bool dictionary_ok = true;
+    std::vector<UserDefinedType> named1, named2;
+    for (int k = 0; k < 2000; k++) {
+        named1.emplace_back(k, "host-" + std::to_string(k % 5) + ".example.com", std::vector<double>{k * 1.0});
+    }
+    binary::options dictionary_formats[4];
+    dictionary_formats[1].compact = true;
+    dictionary_formats[2].compress = true;
+    dictionary_formats[3].columnar = true;
+    for (auto &opts : dictionary_formats) {
+        opts.string_dictionary = true;
+        std::vector<char> named_buf;
+        stream::memory_sink named_sink(named_buf);
+        binary::serialize_to(std::make_tuple(named1, messages1), named_sink, opts);
+        std::tuple<std::vector<UserDefinedType>, std::vector<Message>> named_messages2;
+        stream::memory_source named_source(named_buf);
+        binary::deserialize_from(named_messages2, named_source, opts);
+        dictionary_ok = dictionary_ok && std::get<0>(named_messages2) == named1 && std::get<1>(named_messages2) == messages1;
+    }
+    binary::options dictionary_opts;
+    dictionary_opts.compact = true;
+    binary::options plain_names = dictionary_opts;
+    dictionary_opts.string_dictionary = true;
+    size_t named_size = binary::serialized_size(named1, dictionary_opts);
+    std::cout << "Serialize: " << named1.size() << " records with 5 names in " << named_size << " bytes, "
+              << binary::serialized_size(named1, plain_names) << " bytes without the dictionary" << std::endl;
+    dictionary_ok = dictionary_ok && named_size * 2 < binary::serialized_size(named1, plain_names);
+    // the views of a repeated string share the bytes of its first occurrence
+    std::vector<std::string> names1{"alpha", "beta", "alpha", "", "beta", "", "alpha"};
+    std::vector<std::string_view> name_views;
+    std::vector<char> views_buf;
+    stream::memory_sink views_sink(views_buf);
+    binary::serialize_to(names1, views_sink, dictionary_opts);
+    stream::memory_source views_source(views_buf);
+    binary::deserialize_from(name_views, views_source, dictionary_opts);
+    dictionary_ok = dictionary_ok && std::equal(names1.begin(), names1.end(), name_views.begin(), name_views.end()) &&
+                    name_views[0].data() == name_views[2].data() && name_views[2].data() == name_views[6].data() &&
+                    name_views[0].data() >= views_buf.data() && name_views[0].data() < views_buf.data() + views_buf.size();
+    // the dictionary goes on across the objects of a writer, and past max_dictionary strings
+    std::vector<std::string> many_names1;
+    for (size_t k = 0; k < binary::max_dictionary + 100; k++) {
+        many_names1.push_back(std::to_string(k % (binary::max_dictionary + 50)));
+    }
+    {
+        binary::writer names_writer("dict.data", dictionary_opts);
+        names_writer.write(named1);
+        names_writer.write(named1);
+        names_writer.write(many_names1);
+    }
+    std::vector<std::string> many_names2;
+    binary::reader names_reader("dict.data", dictionary_opts);
+    names_reader.read(named2);
+    dictionary_ok = dictionary_ok && named2 == named1;
+    named2.clear();
+    names_reader.read(named2);
+    names_reader.read(many_names2);
+    dictionary_ok = dictionary_ok && named2 == named1 && many_names2 == many_names1;
+    // a column skipped by the mask does not hold the strings of the others
+    binary::options masked_names = dictionary_opts;
+    masked_names.columnar = true;
+    std::vector<char> masked_buf;
+    stream::memory_sink masked_sink(masked_buf);
+    binary::serialize_to(messages1, masked_sink, masked_names);
+    masked_names.column_mask = 0b100;
+    std::vector<Message> masked_messages;
+    stream::memory_source masked_source(masked_buf);
+    binary::deserialize_from(masked_messages, masked_source, masked_names);
+    dictionary_ok = dictionary_ok && masked_messages.size() == messages1.size() &&
+                    masked_messages[7].tags == messages1[7].tags && masked_messages[7].topic.empty();
+    // the strings copied out of a file are kept for the next deserialization with reuse
+    std::vector<std::string> hosts1, hosts2;
+    for (auto &named : named1) {
+        hosts1.push_back(named.name);
+    }
+    binary::serialize(hosts1, "dict.data", dictionary_opts);
+    binary::options reuse_names = dictionary_opts;
+    reuse_names.reuse = true;
+    int names_fd = open("dict.data", O_RDONLY);
+    stream::fd_source names_source(names_fd);
+    size_t names_allocations = 0;
+    for (int i = 0; i < 3; i++) {
+        ::lseek(names_fd, 0, SEEK_SET);
+        size_t before = allocation_count;
+        binary::deserialize_from(hosts2, names_source, reuse_names);
+        names_allocations = allocation_count - before;
+    }
+    close(names_fd);
+    std::cout << "Allocations of a reused deserialization from a file: " << names_allocations << std::endl;
+    dictionary_ok = dictionary_ok && hosts2 == hosts1 && names_allocations == 0;
+    // a reference to a string not written yet is rejected
+    std::vector<char> corrupt_names;
+    stream::memory_sink corrupt_names_sink(corrupt_names);
+    binary::serialize_to(names1, corrupt_names_sink, dictionary_opts);
+    // the size of the vector, then the tag of the first string
+    corrupt_names[1] = 9;
+    stream::memory_source corrupt_names_source(corrupt_names);
+    try {
+        binary::deserialize_from(names1, corrupt_names_source, dictionary_opts);
+        dictionary_ok = false;
+    } catch (const std::invalid_argument &) {
+    }
+    if (dictionary_ok) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
+    std::cout << "Test for front coding the keys of ordered string containers: \n";
+    bool front_ok = true;
+    std::set<std::string> paths1, paths2{"stale"};
+    for (int k = 0; k < 5000; k++) {
+        paths1.insert("/srv/index/shard-" + std::to_string(k % 7) + "/segment-" + std::to_string(k) + ".dat");
+    }
+    std::map<std::string, int> counters1, counters2{{"old", 1}};
+    for (int k = 0; k < 300; k++) {
+        counters1["https://example.com/api/v1/items/" + std::to_string(k)] = k;
+    }
+    std::set<std::string> odd_keys1{"", std::string("a\0b", 3), std::string("a\0c", 3), "ab"};
+    std::set<std::string> sixteen1, seventeen1;
+    for (int k = 0; k < 17; k++) {
+        seventeen1.insert("key" + std::to_string(k));
+        if (k < 16) {
+            sixteen1.insert("key" + std::to_string(k));
+        }
+    }
+    binary::options front_formats[3];
+    front_formats[0].compact = true;
+    front_formats[1].compact = true;
+    front_formats[1].compress = true;
+    front_formats[2].compact = true;
+    front_formats[2].string_dictionary = true;
+    for (auto &opts : front_formats) {
+        auto front1 = std::make_tuple(paths1, counters1, odd_keys1, sixteen1, seventeen1, std::set<std::string>{},
+                                      std::map<std::string, std::string>{{"k", "v"}});
+        decltype(front1) front2;
+        std::vector<char> front_buf;
+        stream::memory_sink front_sink(front_buf);
+        binary::serialize_to(front1, front_sink, opts);
+        stream::memory_source front_source(front_buf);
+        binary::deserialize_from(front2, front_source, opts);
+        front_ok = front_ok && front2 == front1;
+    }
+    binary::options front_opts;
+    front_opts.compact = true;
+    size_t front_size = binary::serialized_size(paths1, front_opts);
+    std::cout << "Serialize: " << paths1.size() << " paths front coded in " << front_size << " bytes, "
+              << binary::serialized_size(paths1) << " bytes in the fixed format" << std::endl;
+    front_ok = front_ok && front_size * 2 < binary::serialized_size(paths1);
+    // the nodes there are refilled with reuse
+    front_opts.reuse = true;
+    for (auto *keys : {&paths1, &sixteen1, &paths1}) {
+        std::vector<char> reuse_buf;
+        stream::memory_sink reuse_sink(reuse_buf);
+        binary::serialize_to(*keys, reuse_sink, front_opts);
+        stream::memory_source reuse_source(reuse_buf);
+        binary::deserialize_from(paths2, reuse_source, front_opts);
+        front_ok = front_ok && paths2 == *keys;
+    }
+    std::vector<char> counters_buf;
+    stream::memory_sink counters_sink(counters_buf);
+    binary::serialize_to(counters1, counters_sink, front_opts);
+    stream::memory_source counters_source(counters_buf);
+    binary::deserialize_from(counters2, counters_source, front_opts);
+    front_ok = front_ok && counters2 == counters1;
+    // the keys are rebuilt in the strings of the nodes read before, without allocating
+    stream::memory_source counters_again(counters_buf);
+    size_t front_allocations = allocation_count;
+    binary::deserialize_from(counters2, counters_again, front_opts);
+    front_allocations = allocation_count - front_allocations;
+    std::cout << "Allocations of a reused std::map<std::string, int>: " << front_allocations << std::endl;
+    front_ok = front_ok && counters2 == counters1 && front_allocations == 0;
+    front_opts.reuse = false;
+    // the view finds keys without decoding the whole block
+    std::vector<char> paths_buf;
+    stream::memory_sink paths_sink(paths_buf);
+    binary::serialize_to(paths1, paths_sink, front_opts);
+    binary::front_coded_keys paths_view;
+    stream::memory_source paths_source(paths_buf);
+    binary::deserialize_from(paths_view, paths_source, front_opts);
+    front_ok = front_ok && paths_view.size() == paths1.size();
+    size_t path_index = 0;
+    for (const std::string &path : paths1) {
+        front_ok = front_ok && paths_view.contains(path) && paths_view.lower_bound(path) == path_index &&
+                   paths_view.at(path_index) == path;
+        std::string after = path + "!";
+        auto next = paths1.upper_bound(path);
+        front_ok = front_ok && !paths_view.contains(after) &&
+                   paths_view.lower_bound(after) == static_cast<size_t>(std::distance(paths1.begin(), next));
+        path_index++;
+    }
+    front_ok = front_ok && paths_view.lower_bound("") == 0 && paths_view.lower_bound("~") == paths1.size() &&
+               !paths_view.contains("/srv");
+    binary::front_coded_keys empty_view;
+    std::vector<char> empty_keys_buf;
+    stream::memory_sink empty_keys_sink(empty_keys_buf);
+    binary::serialize_to(std::set<std::string>{}, empty_keys_sink, front_opts);
+    stream::memory_source empty_keys_source(empty_keys_buf);
+    binary::deserialize_from(empty_view, empty_keys_source, front_opts);
+    front_ok = front_ok && empty_view.empty() && empty_view.lower_bound("a") == 0 && !empty_view.contains("");
+    // a shared prefix longer than the key before is rejected
+    std::vector<char> corrupt_front;
+    stream::memory_sink corrupt_front_sink(corrupt_front);
+    binary::serialize_to(sixteen1, corrupt_front_sink, front_opts);
+    // the size, the block length, then the prefix and the rest of the first key
+    corrupt_front[2] = 5;
+    stream::memory_source corrupt_front_source(corrupt_front);
+    try {
+        binary::deserialize_from(paths2, corrupt_front_source, front_opts);
+        front_ok = false;
+    } catch (const std::invalid_argument &) {
+    }
+    if (front_ok) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
     return 0;
 }
\ No newline at end of file
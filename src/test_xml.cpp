@@ -39,6 +39,21 @@ bool operator==(const UserDefinedType &lhs, const UserDefinedType &rhs) {
     return lhs.idx == rhs.idx && lhs.name == rhs.name && lhs.data == rhs.data;
 }
 
+// TiedStruct exposes references to its members, which are serialized and deserialized in place
+struct TiedStruct {
+    int idx;
+    std::string name;
+    std::vector<double> data;
+
+    auto get_all_member() -> decltype(auto) {
+        return std::tie(idx, name, data);
+    }
+};
+
+bool operator==(const TiedStruct &lhs, const TiedStruct &rhs) {
+    return lhs.idx == rhs.idx && lhs.name == rhs.name && lhs.data == rhs.data;
+}
+
 /**
  * test_arithmetic - test the serialization and deserialization of arithmetic types,
  * like int, double, short, etc.
@@ -268,6 +283,18 @@ int main() {
         std::cout << "[false]\n";
     }
 
+    std::cout << "Test for serializing TiedStruct: \n";
+    TiedStruct t3{2, "tied", {1.5, 2.5}}, t4;
+    xml::serialize_xml(t3, "TiedStruct", "tied.xml");
+    xml::deserialize_xml(t4, "TiedStruct", "tied.xml");
+    std::cout << "Serialize: " << t3.idx << " " << t3.name << " " << t3.data.size() << std::endl;
+    std::cout << "Deserialize: " << t4.idx << " " << t4.name << " " << t4.data.size() << std::endl;
+    if (t3 == t4) {
+        std::cout << "[true]\n";
+    } else {
+        std::cout << "[false]\n";
+    }
+
     std::cout << "Test for serializing std::unique_ptr<int>: \n";
     std::unique_ptr<int> up1(new int(1)), up2;
     xml::serialize_xml(up1, "std_unique_ptr", "up.xml");